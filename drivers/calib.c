@@ -0,0 +1,276 @@
+#include "calib.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+#include "calib_est.h"
+#include "params.h"
+#include "motor.h"
+#include "encoder.h"
+#include "ultrasonic.h"
+
+/* ---------- Wall / straight run ---------- */
+#define CAL_MIN_WALL_MM    600    // need room to drive at the wall
+#define CAL_MAX_WALL_MM   2000    // beyond this the echo gets unreliable
+#define CAL_STOP_MM        250    // cut the straight run short if this close
+#define CAL_DRIVE_MS      1200
+
+/* ---------- Spins ---------- */
+#define CAL_SETTLE_MS      400    // ramp down + coast before reading anything
+#define CAL_SPIN_BURST_MS  120    // one spin step (~10-20 deg)
+#define CAL_SPIN_REVS      2.4f   // enough to pass the wall twice from anywhere
+#define CAL_MAX_SAMPLES     96
+
+typedef enum {
+    CS_IDLE=0,
+    CS_START,
+    CS_DRIVE,
+    CS_DRIVE_SETTLE,
+    CS_BACK,
+    CS_BACK_SETTLE,
+    CS_SPIN,
+    CS_SPIN_SETTLE,
+    CS_TEST,
+    CS_TEST_SETTLE,
+    CS_DONE,
+    CS_FAILED
+} CalState;
+
+typedef enum { REQ_NONE=0, REQ_START, REQ_ABORT, REQ_DEFAULTS } CalRequest;
+
+typedef struct {
+    CalState st;
+    uint8_t side;            // 0=left 1=right
+    uint8_t test_i;
+    absolute_time_t until;
+    absolute_time_t t0;
+    uint32_t tl0, tr0;       // tick snapshot at phase start
+    float expected_rev;      // ticks per turn from the current params
+    CalibData data;
+    SpinSample samples[CAL_MAX_SAMPLES];
+    int n;
+    const char *why;         // failure reason
+    bool waited;             // last tick only checked the clock
+} Calib;
+
+static Calib C = {0};
+static volatile uint8_t request = REQ_NONE;
+
+static inline void set_until_ms(int ms){ C.until = delayed_by_ms(get_absolute_time(), ms); }
+static inline bool due(void){ return absolute_time_diff_us(get_absolute_time(), C.until) <= 0; }
+
+static inline void snapshot_ticks(void){ encoder_get_ticks(&C.tl0, &C.tr0); }
+
+static inline float mean_ticks_since(void){
+    uint32_t l, r;
+    encoder_get_ticks(&l, &r);
+    return 0.5f * (float)((l - C.tl0) + (r - C.tr0));
+}
+
+static inline void pivot(uint8_t side){ if (side == 0) motor_left(); else motor_right(); }
+static inline uint16_t pivot_ms_90(uint8_t side){
+    return side == 0 ? params_get()->pivot_ms_90_left : params_get()->pivot_ms_90_right;
+}
+
+static void fail(const char *why){
+    motor_stop();
+    C.why = why;
+    C.st = CS_FAILED;
+    printf("[calib] failed: %s\n", why);
+}
+
+/* ---------------- Phases ---------------- */
+static void begin_spin(uint8_t side){
+    C.side = side;
+    C.n = 0;
+    snapshot_ticks();
+    C.samples[C.n++] = (SpinSample){ 0.0f, ultra_read_mm() };
+    pivot(side);
+    set_until_ms(CAL_SPIN_BURST_MS);
+    C.st = CS_SPIN;
+}
+
+static void begin_test(uint8_t i){
+    /* two pivots of different length let the estimator fit an offset */
+    uint16_t ms = pivot_ms_90(C.side);
+    if (i == 1) ms = (uint16_t)(ms * 3 / 2);
+    C.test_i = i;
+    C.data.pivot[C.side].test_ms[i] = ms;
+    snapshot_ticks();
+    pivot(C.side);
+    set_until_ms(ms);
+    C.st = CS_TEST;
+}
+
+static void finish(void){
+    RoverParams p = *params_get();
+    if (!calib_estimate(&C.data, &p)) { fail("measurements implausible"); return; }
+
+    params_set(&p);
+    C.st = CS_DONE;
+    printf("[calib] pivot90 L/R=%u/%u ms | bias=%d deg | drive=%u ms | circum=%.2f mm | track=%.1f mm | full=%u t/s\n",
+           p.pivot_ms_90_left, p.pivot_ms_90_right, p.turnback_bias_deg, p.drive_ms,
+           p.wheel_circum_mm, p.track_width_mm, p.full_speed_tps);
+    if (!params_save()) printf("[calib] WARNING: not saved, values last until reboot\n");
+}
+
+static void begin(void){
+    const RoverParams *p = params_get();
+    memset(&C, 0, sizeof C);
+    C.expected_rev = p->track_width_mm * 3.14159265f * (float)p->counts_per_rev / p->wheel_circum_mm;
+    motor_stop();
+    set_until_ms(CAL_SETTLE_MS);
+    C.st = CS_START;
+    printf("[calib] started (expect ~%.0f ticks/turn)\n", C.expected_rev);
+}
+
+/* main FSM step */
+static void calib_step(void){
+    switch (C.st){
+    case CS_START: {
+        if (!due()) break;
+        uint32_t d = ultra_read_mm();
+        if (d < CAL_MIN_WALL_MM || d > CAL_MAX_WALL_MM) { fail("no wall 0.6-2 m ahead"); break; }
+        C.data.wall_before_mm = d;
+        snapshot_ticks();
+        C.t0 = get_absolute_time();
+        motor_forward();
+        set_until_ms(CAL_DRIVE_MS);
+        C.st = CS_DRIVE;
+    } break;
+
+    case CS_DRIVE: {
+        uint32_t d = ultra_read_mm();
+        if (!due() && !(d && d < CAL_STOP_MM)) break;
+        motor_stop();
+        C.data.drive_ms = (uint32_t)(absolute_time_diff_us(C.t0, get_absolute_time()) / 1000);
+        set_until_ms(CAL_SETTLE_MS);
+        C.st = CS_DRIVE_SETTLE;
+    } break;
+
+    case CS_DRIVE_SETTLE: {
+        if (!due()) break;
+        uint32_t l, r;
+        encoder_get_ticks(&l, &r);
+        C.data.drive_ticks_l = l - C.tl0;
+        C.data.drive_ticks_r = r - C.tr0;
+        C.data.wall_after_mm = ultra_read_mm();
+        if (!C.data.wall_after_mm) { fail("lost the wall on the straight run"); break; }
+        motor_backward();
+        set_until_ms(C.data.drive_ms);
+        C.st = CS_BACK;
+    } break;
+
+    case CS_BACK:
+        if (!due()) break;
+        motor_stop();
+        set_until_ms(CAL_SETTLE_MS);
+        C.st = CS_BACK_SETTLE;
+        break;
+
+    case CS_BACK_SETTLE:
+        if (!due()) break;
+        begin_spin(0);
+        break;
+
+    case CS_SPIN:
+        if (!due()) break;
+        motor_stop();
+        set_until_ms(CAL_SETTLE_MS);
+        C.st = CS_SPIN_SETTLE;
+        break;
+
+    case CS_SPIN_SETTLE: {
+        if (!due()) break;
+        float t = mean_ticks_since();
+        C.samples[C.n++] = (SpinSample){ t, ultra_read_mm() };
+
+        if (t < CAL_SPIN_REVS * C.expected_rev && C.n < CAL_MAX_SAMPLES) {
+            pivot(C.side);
+            set_until_ms(CAL_SPIN_BURST_MS);
+            C.st = CS_SPIN;
+            break;
+        }
+        float rev = calib_find_rev_ticks(C.samples, C.n, C.expected_rev);
+        printf("[calib] spin %s: %d samples, %.0f ticks/turn\n",
+               C.side == 0 ? "LEFT" : "RIGHT", C.n, rev);
+        if (rev <= 0.0f) { fail("wall not found twice while spinning"); break; }
+        C.data.pivot[C.side].rev_ticks = rev;
+        begin_test(0);
+    } break;
+
+    case CS_TEST:
+        if (!due()) break;
+        motor_stop();
+        set_until_ms(CAL_SETTLE_MS);
+        C.st = CS_TEST_SETTLE;
+        break;
+
+    case CS_TEST_SETTLE:
+        if (!due()) break;
+        C.data.pivot[C.side].test_ticks[C.test_i] = mean_ticks_since();
+        if (C.test_i == 0)     begin_test(1);
+        else if (C.side == 0)  begin_spin(1);
+        else                   finish();
+        break;
+
+    case CS_IDLE:
+    case CS_DONE:
+    case CS_FAILED:
+    default:
+        break;
+    }
+}
+
+/* ---------------- Public API ---------------- */
+void calib_start(void)          { request = REQ_START; }
+void calib_abort(void)          { if (C.st != CS_IDLE || request == REQ_START) request = REQ_ABORT; }
+void calib_reset_defaults(void) { request = REQ_DEFAULTS; }
+
+static inline bool running(void){ return C.st != CS_IDLE && C.st != CS_DONE && C.st != CS_FAILED; }
+
+bool calib_tick(void){
+    uint8_t req = request;
+    request = REQ_NONE;
+
+    if (req == REQ_START) begin();
+    else if (req == REQ_ABORT && running()) fail("aborted");
+    else if (req == REQ_DEFAULTS && !running()) {
+        RoverParams p;
+        params_defaults(&p);
+        params_set(&p);
+        params_save();
+        printf("[calib] parameters reset to defaults\n");
+    }
+
+    if (!running()) return false;
+    /* every state but the straight run only checks due() until it is */
+    C.waited = C.st != CS_DRIVE && !due();
+    calib_step();
+    return true;
+}
+
+bool calib_waiting(void){
+    return running() && C.waited;
+}
+
+int calib_format_status(char *buf, size_t n){
+    static const char *NAMES[] = {
+        "idle", "settle", "drive", "drive", "back", "back",
+        "spin", "spin", "test", "test", "done", "failed"
+    };
+    if (C.st == CS_IDLE || n == 0) return 0;
+
+    const RoverParams *p = params_get();
+    int len;
+    if (C.st == CS_DONE)
+        len = snprintf(buf, n, "C: done | pivot90 L/R=%u/%u ms | bias=%d | drive=%u ms | circum=%.2f | track=%.1f | full=%u t/s\r\n",
+                       p->pivot_ms_90_left, p->pivot_ms_90_right, p->turnback_bias_deg,
+                       p->drive_ms, p->wheel_circum_mm, p->track_width_mm, p->full_speed_tps);
+    else if (C.st == CS_FAILED)
+        len = snprintf(buf, n, "C: failed | %s\r\n", C.why);
+    else
+        len = snprintf(buf, n, "C: %s %s | samples=%d\r\n", NAMES[C.st],
+                       C.side == 0 ? "left" : "right", C.n);
+    if (len < 0) return 0;
+    return (len < (int)n) ? len : (int)n - 1;
+}
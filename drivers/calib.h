@@ -0,0 +1,32 @@
+#ifndef CALIB_H
+#define CALIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// On-rover calibration. Place the rover squarely facing a flat wall
+// 0.6-2 m away with room to spin, then send "calibrate" over UDP.
+// It drives at the wall and back (wheel scale, drift), spins past the wall
+// both ways (track width, pivot timing), then saves the result to flash.
+
+// Request a run (safe from the UDP callback; the main loop starts it).
+void calib_start(void);
+
+// Stop a run in progress.
+void calib_abort(void);
+
+// Drop back to the built-in defaults and save them.
+void calib_reset_defaults(void);
+
+// Call every main-loop pass. Returns true while calibration owns the
+// motors; the teleop/mission/avoidance path must be skipped then.
+bool calib_tick(void);
+
+// True if the last calib_tick() only checked the clock: a timed phase
+// still running, nothing measured or driven (for the load figure).
+bool calib_waiting(void);
+
+// Appends one "C: ..." telemetry line; nothing if calibration never ran.
+int calib_format_status(char *buf, size_t n);
+
+#endif // CALIB_H
@@ -0,0 +1,137 @@
+#include "calib_est.h"
+#include <math.h>
+
+#define PI_F        3.14159265f
+#define RAD2DEG(r)  ((r) * 57.2957795f)
+
+#define MIN_TRAVEL_MM   50.0f   // straight run shorter than this is too noisy
+#define MAX_BIAS_DEG    20
+
+/* ---------------- Spin analysis ---------------- */
+
+/* Vertex of the parabola through samples i-1, i, i+1 (in ticks).
+ * Range near a wall goes like d/cos(a) ~ d(1 + a^2/2), so a parabola is a
+ * good local fit and beats the ~burst-sized resolution of the raw samples. */
+static float refine_min(const SpinSample *s, int n, int i) {
+    if (i <= 0 || i >= n - 1 || !s[i - 1].wall_mm || !s[i + 1].wall_mm) return s[i].ticks;
+
+    const float x0 = s[i - 1].ticks, x1 = s[i].ticks, x2 = s[i + 1].ticks;
+    const float y0 = (float)s[i - 1].wall_mm, y1 = (float)s[i].wall_mm, y2 = (float)s[i + 1].wall_mm;
+    const float num = (x1 - x0) * (x1 - x0) * (y1 - y2) - (x1 - x2) * (x1 - x2) * (y1 - y0);
+    const float den = (x1 - x0) * (y1 - y2) - (x1 - x2) * (y1 - y0);
+    if (den == 0.0f) return x1;
+
+    float x = x1 - 0.5f * num / den;
+    if (x < x0) x = x0;
+    if (x > x2) x = x2;
+    return x;
+}
+
+/* index of the closest valid reading with ticks in [lo, hi], -1 if none */
+static int argmin_in(const SpinSample *s, int n, float lo, float hi) {
+    int best = -1;
+    for (int i = 0; i < n; i++) {
+        if (!s[i].wall_mm || s[i].ticks < lo || s[i].ticks > hi) continue;
+        if (best < 0 || s[i].wall_mm < s[best].wall_mm) best = i;
+    }
+    return best;
+}
+
+float calib_find_rev_ticks(const SpinSample *s, int n, float expected_rev) {
+    if (n < 3 || expected_rev <= 0.0f) return 0.0f;
+
+    int i1 = argmin_in(s, n, 0.0f, 1.1f * expected_rev);
+    if (i1 < 0) return 0.0f;
+    const float t1 = refine_min(s, n, i1);
+
+    /* the first window can catch the 2nd pass; look both ways for the partner */
+    int i2 = argmin_in(s, n, t1 + 0.6f * expected_rev, t1 + 1.4f * expected_rev);
+    if (i2 < 0) i2 = argmin_in(s, n, t1 - 1.4f * expected_rev, t1 - 0.6f * expected_rev);
+    if (i2 < 0) return 0.0f;
+
+    /* both minima must be the same wall */
+    const float d1 = (float)s[i1].wall_mm, d2 = (float)s[i2].wall_mm;
+    if (fabsf(d2 - d1) > 0.15f * d1 + 30.0f) return 0.0f;
+
+    return fabsf(refine_min(s, n, i2) - t1);
+}
+
+/* ---------------- Parameter estimation ---------------- */
+
+static float pivot_ms_for(const PivotRun *r) {
+    const float target = r->rev_ticks / 4.0f;
+    const float m0 = r->test_ms[0], m1 = r->test_ms[1];
+    const float k0 = r->test_ticks[0], k1 = r->test_ticks[1];
+
+    /* two points: affine fit, absorbs the fixed ramp/stiction cost */
+    if (k1 > k0 && m1 != m0) return m0 + (target - k0) * (m1 - m0) / (k1 - k0);
+    /* one point: assume rotation proportional to time */
+    if (k0 > 0.0f) return m0 * target / k0;
+    return 0.0f;
+}
+
+bool calib_estimate(const CalibData *d, RoverParams *p) {
+    bool any = false;
+
+    /* wheel scale from the straight run */
+    const float travel = (float)d->wall_before_mm - (float)d->wall_after_mm;
+    const float avg_ticks = 0.5f * (float)(d->drive_ticks_l + d->drive_ticks_r);
+    float mm_per_tick = p->wheel_circum_mm / (float)p->counts_per_rev;
+    const bool have_travel = travel > MIN_TRAVEL_MM && avg_ticks > 0.0f;
+
+    if (have_travel) {
+        const float circum = (travel / avg_ticks) * (float)p->counts_per_rev;
+        if (circum > 10.0f && circum < 1000.0f) {
+            p->wheel_circum_mm = circum;
+            mm_per_tick = travel / avg_ticks;
+            any = true;
+        }
+    }
+
+    /* track width: each wheel rolls pi * track for one turn on the spot */
+    float rev_sum = 0.0f;
+    int rev_n = 0;
+    for (int side = 0; side < 2; side++) {
+        if (d->pivot[side].rev_ticks > 0.0f) { rev_sum += d->pivot[side].rev_ticks; rev_n++; }
+    }
+    if (rev_n) {
+        const float track = (rev_sum / rev_n) * mm_per_tick / PI_F;
+        if (track > 20.0f && track < 1000.0f) { p->track_width_mm = track; any = true; }
+    }
+
+    /* pivot timing per side */
+    for (int side = 0; side < 2; side++) {
+        if (d->pivot[side].rev_ticks <= 0.0f) continue;
+        const float ms = pivot_ms_for(&d->pivot[side]);
+        if (ms < 50.0f || ms > 2000.0f) continue;
+        if (side == 0) p->pivot_ms_90_left  = (uint16_t)(ms + 0.5f);
+        else           p->pivot_ms_90_right = (uint16_t)(ms + 0.5f);
+        any = true;
+    }
+
+    /* side-step drive time and the heading drift it causes */
+    if (have_travel && d->drive_ms > 0) {
+        const float speed = travel / (float)d->drive_ms;   // mm per ms
+        const float ms = CALIB_SIDESTEP_MM / speed;
+        if (ms >= 50.0f && ms <= 5000.0f) { p->drive_ms = (uint16_t)(ms + 0.5f); any = true; }
+
+        /* drifting left (right wheel ahead) while side-stepping left needs a
+         * bigger turn back to the right: bias = drift over one DRIVE step */
+        const float drift_rad = ((float)d->drive_ticks_r - (float)d->drive_ticks_l) * mm_per_tick
+                                / p->track_width_mm;
+        float bias = RAD2DEG(drift_rad) * (float)p->drive_ms / (float)d->drive_ms;
+        if (bias >  MAX_BIAS_DEG) bias =  MAX_BIAS_DEG;
+        if (bias < -MAX_BIAS_DEG) bias = -MAX_BIAS_DEG;
+        p->turnback_bias_deg = (int16_t)lroundf(bias);
+        p->bias_measured = 1;
+    }
+
+    /* wheel speed at full duty, the stall detector's reference. The ramp up
+     * at the start and the ramp down + coast after the stop roughly cancel. */
+    if (avg_ticks > 0.0f && d->drive_ms >= 300) {
+        const float tps = avg_ticks * 1000.0f / (float)d->drive_ms;
+        if (tps >= 20.0f && tps <= 5000.0f) { p->full_speed_tps = (uint16_t)(tps + 0.5f); any = true; }
+    }
+
+    return any;
+}
@@ -0,0 +1,45 @@
+#ifndef CALIB_EST_H
+#define CALIB_EST_H
+
+// Parameter estimation for the calibration routine. Pure C with no SDK
+// dependencies, so it can be fed synthetic data on a host.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "params.h"
+
+// Side-step length the avoidance FSM should cover per DRIVE step
+#define CALIB_SIDESTEP_MM  150.0f
+
+// One reading taken between spin bursts
+typedef struct {
+    float    ticks;      // mean |ticks| of both wheels since the spin started
+    uint32_t wall_mm;    // ultrasonic range, 0 = no echo
+} SpinSample;
+
+typedef struct {
+    float    rev_ticks;      // mean wheel ticks for one full turn on the spot
+    uint16_t test_ms[2];     // two timed pivots of different length...
+    float    test_ticks[2];  // ...and the mean wheel ticks each produced
+} PivotRun;
+
+typedef struct {
+    // straight run towards a wall
+    uint32_t wall_before_mm, wall_after_mm;
+    uint32_t drive_ms;
+    uint32_t drive_ticks_l, drive_ticks_r;
+    // pivots, [0]=left [1]=right
+    PivotRun pivot[2];
+} CalibData;
+
+// Ticks for one full turn from a spin that swept past the wall at least
+// twice: the two range minima (parabola-refined) are one revolution apart.
+// expected_rev is the current estimate and only sets the search windows.
+// Returns 0 if no consistent pair of minima was found.
+float calib_find_rev_ticks(const SpinSample *s, int n, float expected_rev);
+
+// Update *p from the measurements. Fields whose data is implausible keep
+// their old value; returns false if nothing could be estimated.
+bool calib_estimate(const CalibData *d, RoverParams *p);
+
+#endif // CALIB_EST_H
@@ -0,0 +1,143 @@
+#include "diag.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <malloc.h>
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+/* ---------- Stack painting ---------- */
+#define STACK_PAINT       0xC0DEC0DEu
+#define PAINT_MARGIN      256      // bytes below the live SP left alone at init
+
+// Linker-provided region bounds (pico memmap_default.ld)
+extern uint32_t __StackBottom, __StackTop;        // core 0 (SCRATCH_Y)
+extern uint32_t __StackOneBottom, __StackOneTop;  // core 1 (SCRATCH_X)
+extern char __end__, __StackLimit;                // heap may grow between these
+
+/* ---------- lwIP pool names, same order as the memp enum ---------- */
+#if MEMP_STATS
+static const char *const POOL_NAMES[] = {
+#define LWIP_MEMPOOL(name, num, size, desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+#endif
+
+static volatile uint32_t counters[DIAG_COUNTER_COUNT];
+
+/* per-core idle accounting for the load figure. 32-bit so the sampling
+ * timer never sees half an update; differences are taken mod 2^32. */
+static volatile uint32_t idle_us[2];
+static uint32_t last_idle_us[2];
+static uint64_t last_sample_us;
+static volatile uint8_t load_pct[2];
+static uint64_t pass_t0;
+static uint32_t pass_idle0;
+
+static void paint(uint32_t *lo, uint32_t *hi) {
+    for (volatile uint32_t *p = lo; p < hi; ++p) *p = STACK_PAINT;
+}
+
+/* bytes ever used = distance from the top to the deepest overwritten word */
+static uint32_t stack_used(const uint32_t *lo, const uint32_t *hi) {
+    const uint32_t *p = lo;
+    while (p < hi && *p == STACK_PAINT) ++p;
+    return (uint32_t)((const char *)hi - (const char *)p);
+}
+
+/* Load over a fixed window, so the "diag" command and diag-channel
+ * subscribers read the same figure instead of resetting each other's. */
+static bool load_cb(repeating_timer_t *t) {
+    const uint64_t now = time_us_64();
+    const uint32_t span = (uint32_t)(now - last_sample_us);
+    for (int c = 0; c < 2; c++) {
+        uint32_t total = idle_us[c];
+        uint32_t idle = total - last_idle_us[c];
+        last_idle_us[c] = total;
+        /* a wait ending just after the window started is counted whole */
+        load_pct[c] = (span && idle < span) ? (uint8_t)(100 - (uint64_t)idle * 100 / span) : 0;
+    }
+    last_sample_us = now;
+    return true; // keep repeating
+}
+
+/* ---------------- Public API ---------------- */
+void diag_init(void) {
+    uint32_t here;   // roughly the current SP
+    uint32_t *live = (uint32_t *)((uintptr_t)&here - PAINT_MARGIN);
+    if (live > &__StackBottom) paint(&__StackBottom, live);
+    paint(&__StackOneBottom, &__StackOneTop);   // core 1 is not launched yet
+
+    static repeating_timer_t timer;
+    last_sample_us = time_us_64();
+    add_repeating_timer_ms(DIAG_LOAD_MS, load_cb, NULL, &timer);
+}
+
+void diag_count(DiagCounter c) {
+    if (c < DIAG_COUNTER_COUNT) counters[c]++;
+}
+
+void diag_add_idle_us(uint32_t us) {
+    idle_us[get_core_num() & 1] += us;
+}
+
+void diag_pass_begin(void) {
+    pass_t0 = time_us_64();
+    pass_idle0 = idle_us[0];
+}
+
+void diag_pass_idle(void) {
+    uint32_t span = (uint32_t)(time_us_64() - pass_t0);
+    uint32_t counted = idle_us[0] - pass_idle0;
+    if (span > counted) diag_add_idle_us(span - counted);
+}
+
+int diag_format(char *buf, size_t n) {
+    int len = 0;
+#define OUT(...) do { if (len < (int)n) { int k = snprintf(buf + len, n - len, __VA_ARGS__); if (k > 0) len += k; } } while (0)
+
+    const uint64_t now = time_us_64();
+    OUT("D: up=%lus\r\n", (unsigned long)(now / 1000000));
+
+    /* stacks */
+    OUT("stack: c0=%lu/%lu B | c1=%lu/%lu B\r\n",
+        (unsigned long)stack_used(&__StackBottom, &__StackTop),
+        (unsigned long)((char *)&__StackTop - (char *)&__StackBottom),
+        (unsigned long)stack_used(&__StackOneBottom, &__StackOneTop),
+        (unsigned long)((char *)&__StackOneTop - (char *)&__StackOneBottom));
+
+    /* heap */
+    struct mallinfo mi = mallinfo();
+    OUT("heap: used=%d arena=%d cap=%lu B\r\n", mi.uordblks, mi.arena,
+        (unsigned long)(&__StackLimit - &__end__));
+
+    /* CPU load, last full window */
+    OUT("cpu: c0=%u%% over %u ms | c1=%s\r\n", (unsigned)load_pct[0], (unsigned)DIAG_LOAD_MS,
+        stack_used(&__StackOneBottom, &__StackOneTop) ? "running" : "not started");
+
+#if LWIP_STATS
+#if MEM_STATS
+    OUT("lwip mem: used=%lu max=%lu avail=%lu err=%u\r\n",
+        (unsigned long)lwip_stats.mem.used, (unsigned long)lwip_stats.mem.max,
+        (unsigned long)lwip_stats.mem.avail, (unsigned)lwip_stats.mem.err);
+#endif
+#if MEMP_STATS
+    for (int i = 0; i < MEMP_MAX; i++) {
+        const struct stats_mem *m = lwip_stats.memp[i];
+        if (!m || !m->avail) continue;
+        OUT("pool %s: %lu/%lu max=%lu err=%u\r\n", POOL_NAMES[i],
+            (unsigned long)m->used, (unsigned long)m->avail,
+            (unsigned long)m->max, (unsigned)m->err);
+    }
+#endif
+    OUT("drops: link=%u ip=%u udp=%u | udp memerr=%u\r\n",
+        (unsigned)lwip_stats.link.drop, (unsigned)lwip_stats.ip.drop,
+        (unsigned)lwip_stats.udp.drop, (unsigned)lwip_stats.udp.memerr);
+#endif
+
+    OUT("telem: alloc_fail=%lu send_fail=%lu | ctrl: rx=%lu rejected=%lu\r\n",
+        (unsigned long)counters[DIAG_TELEM_ALLOC_FAIL], (unsigned long)counters[DIAG_TELEM_SEND_FAIL],
+        (unsigned long)counters[DIAG_CTRL_RX], (unsigned long)counters[DIAG_CTRL_REJECTED]);
+#undef OUT
+
+    return (len < (int)n) ? len : (int)n - 1;
+}
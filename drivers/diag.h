@@ -0,0 +1,40 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Event counters bumped from the drivers (cheap: one increment each)
+typedef enum {
+    DIAG_TELEM_ALLOC_FAIL = 0,   // pbuf_alloc failed for a telemetry packet
+    DIAG_TELEM_SEND_FAIL,        // udp_sendto returned an error
+    DIAG_CTRL_RX,                // control datagrams received
+    DIAG_CTRL_REJECTED,          // control datagrams we could not use
+    DIAG_COUNTER_COUNT
+} DiagCounter;
+
+// CPU load is sampled on a timer over this window, whoever asks for it
+#define DIAG_LOAD_MS    1000
+
+// Call first thing in main(): paints both core stacks so high-water
+// marks can be measured later, and starts the load sampling timer.
+void diag_init(void);
+
+void diag_count(DiagCounter c);
+
+// Time the calling core spent waiting (sleeps, echo polling). Used for
+// the per-core CPU load figure; everything else counts as busy.
+// Interrupts taken during a wait count as waiting too.
+void diag_add_idle_us(uint32_t us);
+
+// Bracket a main-loop pass. diag_pass_idle() marks the pass as one that
+// only polled (a clock, a held stop) and counts all of it as waiting,
+// less any waits already added inside it.
+void diag_pass_begin(void);
+void diag_pass_idle(void);
+
+// Full report (stacks, heap, lwIP pools, drops, CPU load) as text lines.
+// CPU load is the last DIAG_LOAD_MS window. Returns chars written.
+int diag_format(char *buf, size_t n);
+
+#endif // DIAG_H
@@ -8,13 +8,9 @@
 
 #include "hardware/gpio.h"
 
-// --- ADD THESE LWIP INCLUDES ---
+#include "params.h"
 
-#include "lwip/udp.h"
 
-#include "lwip/pbuf.h"
-
-// --- END ADD ---
 
 
 
@@ -26,9 +22,7 @@
 
 #define PRINT_MS          500    
 
-#define COUNTS_PER_REV    80      
-
-#define WHEEL_CIRCUM_MM   58.94f  
+// Wheel circumference and counts/rev come from params.c
 
 
 
@@ -38,23 +32,21 @@ static volatile uint32_t tick_count_left = 0;
 
 static volatile uint32_t tick_count_right = 0;
 
-static double distance_mm_total_left = 0;
-
-static double distance_mm_total_right = 0;
-
+// Running totals (never reset) for odometry consumers such as mission.c
 
+static volatile uint32_t tick_total_left = 0;
 
-// --- ADD THESE TELEMETRY GLOBALS ---
+static volatile uint32_t tick_total_right = 0;
 
-static struct udp_pcb *telemetry_pcb = NULL;
+// time_us_32() of the latest edge, for the stall detector (stall.c)
 
-static ip_addr_t telemetry_addr;
+static volatile uint32_t edge_us_left = 0;
 
-static u16_t telemetry_port;
+static volatile uint32_t edge_us_right = 0;
 
-static bool telemetry_target_set = false;
+static double distance_mm_total_left = 0;
 
-// --- END ADD ---
+static double distance_mm_total_right = 0;
 
 
 
@@ -66,7 +58,7 @@ static bool telemetry_target_set = false;
 
 static inline double mm_per_tick(void) {
 
-    return (double)WHEEL_CIRCUM_MM / (double)COUNTS_PER_REV;
+    return (double)params_get()->wheel_circum_mm / (double)params_get()->counts_per_rev;
 
 }
 
@@ -80,10 +72,18 @@ static void sensor_isr(uint gpio, uint32_t events) {
 
             tick_count_left++;
 
+            tick_total_left++;
+
+            edge_us_left = time_us_32();
+
         } else if (gpio == SENSOR_PIN_RIGHT) {
 
             tick_count_right++;
 
+            tick_total_right++;
+
+            edge_us_right = time_us_32();
+
         }
 
     }
@@ -92,7 +92,7 @@ static void sensor_isr(uint gpio, uint32_t events) {
 
 
 
-// This timer callback now PRINTS *and* SENDS UDP
+// Prints wheel speeds to USB serial; UDP telemetry is telemetry.c
 
 static bool print_cb(repeating_timer_t *t) {
 
@@ -118,7 +118,7 @@ static bool print_cb(repeating_timer_t *t) {
 
     // Left Wheel
 
-    const double revs_l     = (double)ticks_l / COUNTS_PER_REV;
+    const double revs_l     = (double)ticks_l / params_get()->counts_per_rev;
 
     const double rpm_l      = (revs_l / interval_s) * 60.0;
 
@@ -132,7 +132,7 @@ static bool print_cb(repeating_timer_t *t) {
 
     // Right Wheel
 
-    const double revs_r     = (double)ticks_r / COUNTS_PER_REV;
+    const double revs_r     = (double)ticks_r / params_get()->counts_per_rev;
 
     const double rpm_r      = (revs_r / interval_s) * 60.0;
 
@@ -158,86 +158,46 @@ static bool print_cb(repeating_timer_t *t) {
 
 
 
-    // --- 4. ADD THIS: Send Report over UDP ---
-
-    if (telemetry_target_set) {
-
-        // A. Format the *exact same* string
-
-        // (Use a static buffer to avoid stack overflow)
-
-        static char telemetry_buf[256];
-
-        int len = snprintf(telemetry_buf, sizeof(telemetry_buf),
-
-            "L: ticks=%-4lu | rpm=%-6.1f | speed=%-5.1f mm/s | total=%.1f mm\r\n"
-
-            "R: ticks=%-4lu | rpm=%-6.1f | speed=%-5.1f mm/s | total=%.1f mm\r\n---\r\n",
-
-            (unsigned long)ticks_l, rpm_l, mm_per_s_l, distance_mm_total_left,
 
-            (unsigned long)ticks_r, rpm_r, mm_per_s_r, distance_mm_total_right);
 
+    return true; // keep repeating
 
+}
 
-        // B. Allocate a packet buffer
-
-        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
-
-        if (p != NULL) {
-
-            // C. Copy the string into the buffer
-
-            memcpy(p->payload, telemetry_buf, len);
-
-           
-
-            // D. Send the UDP packet
-
-            udp_sendto(telemetry_pcb, p, &telemetry_addr, telemetry_port);
 
-           
 
-            // E. Free the buffer
 
-            pbuf_free(p);
 
-        }
+// ========== PUBLIC FUNCTIONS ==========
 
-    }
 
-    // --- END ADD ---
 
+void encoder_get_ticks(uint32_t *left, uint32_t *right) {
 
+    *left = tick_total_left;
 
-    return true; // keep repeating
+    *right = tick_total_right;
 
 }
 
 
 
+void encoder_get_last_edge_us(uint32_t *left, uint32_t *right) {
 
+    *left = edge_us_left;
 
-// ========== PUBLIC FUNCTIONS ==========
-
+    *right = edge_us_right;
 
+}
 
-// --- ADD THIS FUNCTION DEFINITION ---
-
-void encoder_set_remote_udp_target(struct udp_pcb *pcb, const ip_addr_t *addr, u16_t port) {
-
-    telemetry_pcb = pcb;
 
-    ip_addr_copy(telemetry_addr, *addr);
 
-    telemetry_port = port;
+float encoder_mm_per_tick(void) {
 
-    telemetry_target_set = true;
+    return (float)mm_per_tick();
 
 }
 
-// --- END ADD ---
-
 
 
 
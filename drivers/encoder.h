@@ -1,19 +1,20 @@
 #ifndef ENCODER_H
 #define ENCODER_H
 
-// --- ADD THESE ---
-#include "lwip/ip_addr.h" // For ip_addr_t
-struct udp_pcb; // Forward declaration is fine for a pointer
-// --- END ADD ---
+#include <stdint.h>
 
 // Call this once in main() to set up the encoders,
 // interrupts, and reporting timer.
 void encoder_init(void);
 
-// --- ADD THIS FUNCTION PROTOTYPE ---
-// Call this from udp_recv_cb in main.c to tell the encoder
-// where to send telemetry data.
-void encoder_set_remote_udp_target(struct udp_pcb *pcb, const ip_addr_t *addr, u16_t port);
-// --- END ADD ---
+// Running encoder tick totals since boot (unsigned, never reset).
+// Encoders are single-channel, so direction comes from motor_get_dir().
+void encoder_get_ticks(uint32_t *left, uint32_t *right);
+
+// time_us_32() of each wheel's most recent encoder edge.
+void encoder_get_last_edge_us(uint32_t *left, uint32_t *right);
+
+// Distance travelled by one wheel per encoder tick.
+float encoder_mm_per_tick(void);
 
 #endif // ENCODER_H
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "mission.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "motor.h"
+#include "encoder.h"
+#include "params.h"
+
+/* ---------- Waypoint follower tuning ---------- */
+#define WP_TOL_MM           40.0f   // "arrived" radius
+#define PIVOT_ENTER_DEG     25.0f   // heading error that starts an on-spot pivot
+#define PIVOT_EXIT_DEG      10.0f   // ...and the error at which the pivot ends
+#define ARC_DEG              5.0f   // below this just drive straight
+
+#define PI_F       3.14159265f
+#define RAD2DEG(r) ((r) * 57.2957795f)
+
+/* ---------------- Step queue ---------------- */
+typedef enum { STEP_WAYPOINT=0, STEP_TIMED } StepKind;
+
+typedef struct {
+    uint8_t  kind;      // StepKind
+    uint8_t  cmd;       // DriveCmd (timed)
+    int16_t  x_mm, y_mm;// target (waypoint)
+    uint16_t ms;        // duration (timed)
+} MissionStep;
+
+typedef enum { MS_IDLE=0, MS_RUNNING, MS_DONE, MS_ABORTED } MissionState;
+typedef enum { OP_NONE=0, OP_REPLACE, OP_APPEND, OP_ABORT } PendingOp;
+
+/* ring buffer owned by the main loop */
+static MissionStep q[MISSION_MAX_STEPS];
+static uint8_t q_head = 0, q_count = 0;
+
+/* staging area written by the UDP callback, adopted by mission_tick() */
+static MissionStep staged[MISSION_MAX_STEPS];
+static uint8_t staged_n = 0;
+static volatile uint8_t staged_op = OP_NONE;
+
+typedef struct {
+    MissionState state;
+    uint16_t done;          // steps completed this mission
+    bool step_started;
+    bool pivoting;          // waypoint hysteresis latch
+    int64_t remaining_us;   // timed step
+    absolute_time_t last;
+    DriveCmd out;
+} Executor;
+
+static Executor E = {0};
+
+/* ---------------- Odometry ---------------- */
+typedef struct {
+    float x, y, th;         // mm, mm, rad (0 = facing +x at mission start)
+    uint32_t last_l, last_r;
+    int8_t dir_l, dir_r;    // sign applied to ticks (kept while coasting)
+} Odometry;
+
+static Odometry O = {0};
+
+static inline float wrap_pi(float a) {
+    while (a >  PI_F) a -= 2.0f * PI_F;
+    while (a < -PI_F) a += 2.0f * PI_F;
+    return a;
+}
+
+static void odo_reset(void) {
+    memset(&O, 0, sizeof O);
+    encoder_get_ticks(&O.last_l, &O.last_r);
+}
+
+static void odo_update(void) {
+    uint32_t l, r;
+    int8_t dl, dr;
+    encoder_get_ticks(&l, &r);
+    motor_get_dir(&dl, &dr);
+    if (dl) O.dir_l = dl;
+    if (dr) O.dir_r = dr;
+
+    const float k = encoder_mm_per_tick();
+    const float sl = (float)(uint32_t)(l - O.last_l) * k * O.dir_l;
+    const float sr = (float)(uint32_t)(r - O.last_r) * k * O.dir_r;
+    O.last_l = l;
+    O.last_r = r;
+
+    const float ds  = 0.5f * (sl + sr);
+    const float dth = (sr - sl) / params_get()->track_width_mm;
+    const float mid = O.th + 0.5f * dth;
+    O.x += ds * cosf(mid);
+    O.y += ds * sinf(mid);
+    O.th = wrap_pi(O.th + dth);
+}
+
+/* ---------------- Parsing ---------------- */
+static const struct { const char *name; DriveCmd cmd; } CMD_NAMES[] = {
+    {"forward_left",   CMD_FWD_LEFT},
+    {"forward_right",  CMD_FWD_RIGHT},
+    {"backward_left",  CMD_BWD_LEFT},
+    {"backward_right", CMD_BWD_RIGHT},
+    {"forward",        CMD_FORWARD},
+    {"backward",       CMD_BACKWARD},
+    {"left",           CMD_LEFT},
+    {"right",          CMD_RIGHT},
+    {"stop",           CMD_STOP},
+};
+
+static const char *skip_ws(const char *s) {
+    while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
+    return s;
+}
+
+static bool parse_cmd_name(const char **s, DriveCmd *out) {
+    for (size_t i = 0; i < sizeof CMD_NAMES / sizeof CMD_NAMES[0]; ++i) {
+        size_t m = strlen(CMD_NAMES[i].name);
+        if (strncmp(*s, CMD_NAMES[i].name, m) == 0) {
+            *s += m;
+            *out = CMD_NAMES[i].cmd;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* parse one "w x y" / "t cmd ms" step; leaves *s after the step */
+static bool parse_step(const char **s, MissionStep *st) {
+    const char *p = skip_ws(*s);
+    char *end;
+    memset(st, 0, sizeof *st);
+
+    if (*p == 'w' || *p == 'W') {
+        long x = strtol(p + 1, &end, 10); if (end == p + 1) return false;
+        p = end;
+        long y = strtol(p, &end, 10);     if (end == p) return false;
+        if (x < INT16_MIN || x > INT16_MAX || y < INT16_MIN || y > INT16_MAX) return false;
+        st->kind = STEP_WAYPOINT;
+        st->x_mm = (int16_t)x;
+        st->y_mm = (int16_t)y;
+    } else if (*p == 't' || *p == 'T') {
+        DriveCmd c;
+        p = skip_ws(p + 1);
+        if (!parse_cmd_name(&p, &c)) return false;
+        long ms = strtol(p, &end, 10);    if (end == p) return false;
+        if (ms <= 0 || ms > UINT16_MAX) return false;
+        st->kind = STEP_TIMED;
+        st->cmd = (uint8_t)c;
+        st->ms = (uint16_t)ms;
+    } else {
+        return false;
+    }
+    *s = end;
+    return true;
+}
+
+/* ---------------- Public API ---------------- */
+int mission_load(const char *text, bool append) {
+    MissionStep tmp[MISSION_MAX_STEPS];
+    int n = 0;
+    const char *s = text;
+
+    while (*(s = skip_ws(s))) {
+        if (n >= MISSION_MAX_STEPS) return 0;
+        if (!parse_step(&s, &tmp[n])) return 0;
+        n++;
+        s = skip_ws(s);
+        if (*s == ';') s++;
+        else if (*s) return 0;
+    }
+    if (n == 0) return 0;
+
+    uint32_t irq = save_and_disable_interrupts();
+    uint8_t op = staged_op;
+    uint8_t base = staged_n;
+    if (!append || op == OP_NONE || op == OP_ABORT) {
+        /* an append after an abort the main loop has not seen starts afresh */
+        op = (append && op != OP_ABORT) ? OP_APPEND : OP_REPLACE;
+        base = 0;
+    }
+    /* else: the main loop has not taken the last load/append yet, so add
+     * to it and keep its op (an append to a staged load is part of it) */
+
+    /* The live queue only shrinks until take_pending(), so an append that
+     * fits now still fits then; one that does not is refused here rather
+     * than cut short later. */
+    int room = MISSION_MAX_STEPS - base;
+    if (op == OP_APPEND && E.state == MS_RUNNING) room -= q_count;
+    if (n > room) { restore_interrupts(irq); return 0; }
+
+    memcpy(&staged[base], tmp, n * sizeof tmp[0]);
+    staged_n = (uint8_t)(base + n);
+    staged_op = op;
+    restore_interrupts(irq);
+    return n;
+}
+
+void mission_abort(void) {
+    staged_op = OP_ABORT;
+}
+
+/* adopt whatever the UDP callback staged since the last tick */
+static void take_pending(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    uint8_t op = staged_op;
+    staged_op = OP_NONE;
+    bool was_running = (E.state == MS_RUNNING);
+
+    if (op == OP_ABORT) {
+        q_count = 0;
+        if (was_running) E.state = MS_ABORTED;
+    } else if (op == OP_REPLACE || op == OP_APPEND) {
+        bool fresh = (op == OP_REPLACE) || E.state != MS_RUNNING;
+        if (fresh) {
+            q_head = q_count = 0;
+            E.done = 0;
+            E.step_started = false;
+            odo_reset();
+        }
+        for (uint8_t i = 0; i < staged_n && q_count < MISSION_MAX_STEPS; ++i) {
+            q[(q_head + q_count) % MISSION_MAX_STEPS] = staged[i];
+            q_count++;
+        }
+        staged_n = 0;
+        E.state = MS_RUNNING;
+        E.last = get_absolute_time();
+    }
+    restore_interrupts(irq);
+
+    if (op == OP_ABORT) { if (was_running) printf("[mission] aborted\n"); }
+    else if (op != OP_NONE) printf("[mission] %s, %u steps queued\n",
+                                   op == OP_APPEND ? "appended" : "loaded", (unsigned)q_count);
+}
+
+static inline void next_step(void) {
+    q_head = (q_head + 1) % MISSION_MAX_STEPS;
+    q_count--;
+    E.done++;
+    E.step_started = false;
+}
+
+/* returns true when the waypoint has been reached */
+static bool follow_waypoint(const MissionStep *st) {
+    const float dx = (float)st->x_mm - O.x;
+    const float dy = (float)st->y_mm - O.y;
+    if (hypotf(dx, dy) < WP_TOL_MM) return true;
+
+    const float err = RAD2DEG(wrap_pi(atan2f(dy, dx) - O.th));
+    const float mag = fabsf(err);
+
+    if (mag > PIVOT_ENTER_DEG) E.pivoting = true;
+    else if (mag < PIVOT_EXIT_DEG) E.pivoting = false;
+
+    if (E.pivoting)          E.out = (err > 0) ? CMD_LEFT : CMD_RIGHT;
+    else if (mag > ARC_DEG)  E.out = (err > 0) ? CMD_FWD_LEFT : CMD_FWD_RIGHT;
+    else                     E.out = CMD_FORWARD;
+    return false;
+}
+
+bool mission_tick(DriveCmd *out) {
+    if (staged_op != OP_NONE) take_pending();
+    if (E.state != MS_RUNNING) return false;
+
+    absolute_time_t now = get_absolute_time();
+    int64_t dt_us = absolute_time_diff_us(E.last, now);
+    E.last = now;
+    odo_update();
+
+    /* avoidance owns the motors: freeze timed steps, waypoints re-aim later */
+    bool held = ultra_is_avoiding();
+
+    while (q_count) {
+        const MissionStep *st = &q[q_head];
+        if (!E.step_started) {
+            E.step_started = true;
+            E.pivoting = false;
+            E.remaining_us = (int64_t)st->ms * 1000;
+            dt_us = 0;   // time starts counting from the next tick
+        }
+
+        if (st->kind == STEP_TIMED) {
+            if (!held) E.remaining_us -= dt_us;
+            if (E.remaining_us > 0) { E.out = (DriveCmd)st->cmd; break; }
+        } else if (!follow_waypoint(st)) {
+            break;
+        }
+        next_step();
+    }
+
+    if (!q_count) {
+        E.state = MS_DONE;
+        E.out = CMD_STOP;
+        printf("[mission] done, %u steps\n", (unsigned)E.done);
+    }
+    *out = E.out;
+    return true;
+}
+
+int mission_format_status(char *buf, size_t n) {
+    static const char *NAMES[] = {"idle", "run", "done", "aborted"};
+    if (E.state == MS_IDLE || n == 0) return 0;
+
+    int len = snprintf(buf, n, "M: state=%s | step=%u/%u | x=%.0f y=%.0f mm | th=%.0f deg\r\n",
+                       NAMES[E.state], (unsigned)E.done, (unsigned)(E.done + q_count),
+                       O.x, O.y, RAD2DEG(O.th));
+    if (len < 0) return 0;
+    return (len < (int)n) ? len : (int)n - 1;
+}
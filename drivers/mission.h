@@ -0,0 +1,35 @@
+#ifndef MISSION_H
+#define MISSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ultrasonic.h"   // DriveCmd
+
+// Max steps held onboard (waypoints + timed segments together)
+#define MISSION_MAX_STEPS 32
+
+// Queue a batched mission received in ONE datagram. Steps are separated
+// by ';' and are either
+//   w <x_mm> <y_mm>      drive to a point (relative to the pose at start)
+//   t <cmd> <ms>         hold a drive command (forward, left, ...) for ms
+// e.g. "w 500 0; w 500 500; t left 250; t stop 100".
+// append=false replaces whatever is running, append=true adds to the tail.
+// An append that would overflow MISSION_MAX_STEPS is rejected whole.
+// Safe to call from the UDP callback; the main loop picks it up.
+// Returns number of steps parsed, 0 if the text was rejected.
+int mission_load(const char *text, bool append);
+
+// Drop the queue and stop (also safe from the UDP callback).
+void mission_abort(void);
+
+// Call every main-loop pass. Returns true while a mission owns the drive;
+// *out is then the command the executor wants (still goes through
+// ultra_obstacle_aware_apply so obstacle avoidance keeps priority).
+bool mission_tick(DriveCmd *out);
+
+// Appends one "M: ..." telemetry line; writes nothing if no mission ran yet.
+// Returns number of chars written.
+int mission_format_status(char *buf, size_t n);
+
+#endif // MISSION_H
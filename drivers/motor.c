@@ -1,6 +1,9 @@
 #include "motor.h"
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "profile.h"
 
 // --- Pin Definitions ---
 // These are now private to the motor driver
@@ -10,59 +13,146 @@
 #define M2B 11
 #define STBY 15
 
-// --- Function Definitions ---
+// --- PWM ---
+// M1A/M1B share one slice (channels A/B), M2A/M2B the next one, so each
+// wheel's two inputs live in one CC register and change with one write.
+#define MOTOR_PWM_TOP 6249   // 125 MHz / 6250 = 20 kHz, above hearing
+#define PWM_FULL      (MOTOR_PWM_TOP + 1)
 
-void motor_init_pins(void) {
-    const uint pins[] = {M1A, M1B, M2A, M2B, STBY};
-    for (int i = 0; i < 5; ++i) {
-        gpio_init(pins[i]);
-        gpio_set_dir(pins[i], GPIO_OUT);
-        gpio_put(pins[i], 0);
-    }
-    gpio_put(STBY, 1);
-}
+// CC writes are latched at the counter wrap. Both slices run in phase, so
+// writing the pair while the counter is clear of the wrap puts both on the
+// same cycle. The guard only needs to cover the two stores, which is why
+// the write path runs from RAM: an XIP cache miss between the counter read
+// and the stores could take longer than the guard.
+#define WRAP_GUARD    64
+
+// --- Command table: per-wheel direction for every DriveCmd ---
+// M1 is the left wheel, M2 the right one.
+static const int8_t DRIVE_TABLE[CMD_COUNT][2] = {
+    [CMD_STOP]      = { 0,  0},
+    [CMD_FORWARD]   = { 1,  1},
+    [CMD_BACKWARD]  = {-1, -1},
+    [CMD_LEFT]      = {-1,  1},
+    [CMD_RIGHT]     = { 1, -1},
+    [CMD_FWD_LEFT]  = { 0,  1},
+    [CMD_FWD_RIGHT] = { 1,  0},
+    [CMD_BWD_LEFT]  = { 0, -1},
+    [CMD_BWD_RIGHT] = {-1,  0},
+};
+
+// --- Output table: wheel state -> CC register word (B << 16 | A) ---
+// cc = level * CC_MUL[state] | CC_FIX[state]: the level lands on the input
+// that drives, the other input is held low (or both high when braking).
+typedef enum { WHEEL_COAST=0, WHEEL_FWD, WHEEL_REV, WHEEL_BRAKE, WHEEL_STATE_COUNT } WheelState;
+
+#define CC(a, b) (((uint32_t)(b) << 16) | (uint32_t)(a))
+
+static const uint32_t CC_MUL[WHEEL_STATE_COUNT] = {
+    [WHEEL_COAST] = 0,
+    [WHEEL_FWD]   = CC(1, 0),
+    [WHEEL_REV]   = CC(0, 1),
+    [WHEEL_BRAKE] = 0,
+};
+static const uint32_t CC_FIX[WHEEL_STATE_COUNT] = {
+    [WHEEL_COAST] = CC(0, 0),
+    [WHEEL_FWD]   = 0,
+    [WHEEL_REV]   = 0,
+    [WHEEL_BRAKE] = CC(PWM_FULL, PWM_FULL),
+};
+
+// Last commanded direction per wheel (+1 fwd, -1 back, 0 off).
+static volatile int8_t dir_left = 0;
+static volatile int8_t dir_right = 0;
 
-void motor_stop(void) {
-    gpio_put(M1A, 0); gpio_put(M1B, 0);
-    gpio_put(M2A, 0); gpio_put(M2B, 0);
+static volatile uint8_t stop_state = WHEEL_COAST;
+// Set by motor_halt(): overrides stop_state until a wheel is driven again.
+static volatile uint8_t halt_state = WHEEL_STATE_COUNT;
+static uint slice_left, slice_right;
+
+// Q15 velocity -> PWM level
+static inline uint32_t level_of(int16_t v) {
+    uint32_t mag = (v < 0) ? (uint32_t)(-(int32_t)v) : (uint32_t)v;
+    if (mag >= PROFILE_VMAX) return PWM_FULL;   // 100% on
+    return (mag * PWM_FULL) >> 15;
 }
 
-void motor_forward(void) {
-    gpio_put(M1A, 1); gpio_put(M1B, 0);
-    gpio_put(M2A, 1); gpio_put(M2B, 0);
+static inline uint32_t cc_of(int16_t v, uint8_t zero_state) {
+    uint8_t st = (v > 0) ? WHEEL_FWD : (v < 0) ? WHEEL_REV : zero_state;
+    return level_of(v) * CC_MUL[st] | CC_FIX[st];
 }
 
-void motor_backward(void) {
-    gpio_put(M1A, 0); gpio_put(M1B, 1);
-    gpio_put(M2A, 0); gpio_put(M2B, 1);
+// Not inlined, so the words are worked out (table reads from flash
+// included) before the counter is read. Each SDK call is one register access.
+static void __no_inline_not_in_flash_func(write_cc_pair)(uint32_t cc_l, uint32_t cc_r) {
+    uint32_t irq = save_and_disable_interrupts();
+    while (pwm_get_counter(slice_left) > MOTOR_PWM_TOP - WRAP_GUARD) tight_loop_contents();
+    pwm_set_both_levels(slice_left,  (uint16_t)cc_l, (uint16_t)(cc_l >> 16));
+    pwm_set_both_levels(slice_right, (uint16_t)cc_r, (uint16_t)(cc_r >> 16));
+    restore_interrupts(irq);
 }
 
-void motor_left(void) {
-    gpio_put(M1A, 0); gpio_put(M1B, 1);
-    gpio_put(M2A, 1); gpio_put(M2B, 0);
+// --- Function Definitions ---
+
+void motor_init_pins(void) {
+    const uint pins[] = {M1A, M1B, M2A, M2B};
+    slice_left = pwm_gpio_to_slice_num(M1A);
+    slice_right = pwm_gpio_to_slice_num(M2A);
+
+    pwm_config cfg = pwm_get_default_config();
+    pwm_config_set_wrap(&cfg, MOTOR_PWM_TOP);
+    pwm_init(slice_left, &cfg, false);
+    pwm_init(slice_right, &cfg, false);
+    pwm_set_both_levels(slice_left, 0, 0);
+    pwm_set_both_levels(slice_right, 0, 0);
+    for (int i = 0; i < 4; ++i) {
+        gpio_set_function(pins[i], GPIO_FUNC_PWM);
+    }
+    // start both slices on the same cycle so their wraps stay aligned
+    pwm_set_mask_enabled((1u << slice_left) | (1u << slice_right));
+
+    gpio_init(STBY);
+    gpio_set_dir(STBY, GPIO_OUT);
+    gpio_put(STBY, 1);
 }
 
-void motor_right(void) {
-    gpio_put(M1A, 1); gpio_put(M1B, 0);
-    gpio_put(M2A, 0); gpio_put(M2B, 1);
+void __not_in_flash_func(motor_write)(int16_t left, int16_t right) {
+    if (left || right) halt_state = WHEEL_STATE_COUNT;
+    uint8_t zero = (halt_state < WHEEL_STATE_COUNT) ? halt_state : stop_state;
+    write_cc_pair(cc_of(left, zero), cc_of(right, zero));
+    dir_left  = (left > 0) - (left < 0);
+    dir_right = (right > 0) - (right < 0);
 }
 
-void motor_forward_left(void) {
-    gpio_put(M1A, 0); gpio_put(M1B, 0);
-    gpio_put(M2A, 1); gpio_put(M2B, 0);
+void motor_apply(DriveCmd cmd) {
+    if ((unsigned)cmd >= CMD_COUNT) cmd = CMD_STOP;
+    profile_set_target(DRIVE_TABLE[cmd][0] * PROFILE_VMAX,
+                       DRIVE_TABLE[cmd][1] * PROFILE_VMAX);
 }
 
-void motor_forward_right(void) {
-    gpio_put(M1A, 1); gpio_put(M1B, 0);
-    gpio_put(M2A, 0); gpio_put(M2B, 0);
+void motor_stop(void)           { motor_apply(CMD_STOP); }
+void motor_forward(void)        { motor_apply(CMD_FORWARD); }
+void motor_backward(void)       { motor_apply(CMD_BACKWARD); }
+void motor_left(void)           { motor_apply(CMD_LEFT); }
+void motor_right(void)          { motor_apply(CMD_RIGHT); }
+void motor_forward_left(void)   { motor_apply(CMD_FWD_LEFT); }
+void motor_forward_right(void)  { motor_apply(CMD_FWD_RIGHT); }
+void motor_backward_left(void)  { motor_apply(CMD_BWD_LEFT); }
+void motor_backward_right(void) { motor_apply(CMD_BWD_RIGHT); }
+
+void motor_set_stop_mode(MotorStopMode mode) {
+    stop_state = (mode == MOTOR_BRAKE) ? WHEEL_BRAKE : WHEEL_COAST;
 }
 
-void motor_backward_left(void) {
-    gpio_put(M1A, 0); gpio_put(M1B, 0);
-    gpio_put(M2A, 0); gpio_put(M2B, 1);
+void __not_in_flash_func(motor_halt)(MotorStopMode mode) {
+    uint32_t irq = save_and_disable_interrupts();
+    halt_state = (mode == MOTOR_BRAKE) ? WHEEL_BRAKE : WHEEL_COAST;
+    profile_halt();
+    write_cc_pair(CC_FIX[halt_state], CC_FIX[halt_state]);
+    dir_left = dir_right = 0;
+    restore_interrupts(irq);
 }
 
-void motor_backward_right(void) {
-    gpio_put(M1A, 0); gpio_put(M1B, 1);
-    gpio_put(M2A, 0); gpio_put(M2B, 0);
-}
\ No newline at end of file
+void motor_get_dir(int8_t *left, int8_t *right) {
+    *left = dir_left;
+    *right = dir_right;
+}
@@ -1,10 +1,37 @@
 #ifndef MOTOR_H
 #define MOTOR_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== Drive command type (one row of the actuation table in motor.c) =====
+typedef enum {
+    CMD_STOP = 0,
+    CMD_FORWARD,
+    CMD_BACKWARD,
+    CMD_LEFT,
+    CMD_RIGHT,
+    CMD_FWD_LEFT,
+    CMD_FWD_RIGHT,
+    CMD_BWD_LEFT,
+    CMD_BWD_RIGHT,
+    CMD_COUNT
+} DriveCmd;
+
+// What a wheel does when its velocity is zero
+typedef enum {
+    MOTOR_COAST = 0,   // both inputs low, wheel free-wheels (default)
+    MOTOR_BRAKE        // both inputs high, wheel shorted to a stop
+} MotorStopMode;
+
 // Call this once in main() to set up the motor pins
 void motor_init_pins(void);
 
-// Motor action commands
+// Drive by command: looks up the per-wheel target in a constant table and
+// hands it to the motion profile (profile.c), which ramps the wheels there.
+void motor_apply(DriveCmd cmd);
+
+// Named shorthands for motor_apply()
 void motor_stop(void);
 void motor_forward(void);
 void motor_backward(void);
@@ -15,4 +42,22 @@ void motor_forward_right(void);
 void motor_backward_left(void);
 void motor_backward_right(void);
 
-#endif // MOTOR_H
\ No newline at end of file
+// Coast or brake at zero velocity; takes effect on the next output write.
+void motor_set_stop_mode(MotorStopMode mode);
+
+// Immediate stop that skips the ramp. mode holds until a wheel is next
+// driven; the stop mode set by motor_set_stop_mode() is left as it was.
+// Constant time, no locks beyond a short interrupt-off section, so it is
+// safe from any context incl. ISRs.
+void motor_halt(MotorStopMode mode);
+
+// Raw per-wheel output, Q15 signed duty (see PROFILE_VMAX).
+// Bypasses the ramp; normally only called from the profile timer.
+// Both wheels change on the same PWM cycle, never one before the other.
+void motor_write(int16_t left, int16_t right);
+
+// Direction each wheel is currently being driven in: +1 forward,
+// -1 backward, 0 off. Used by odometry to sign the encoder ticks.
+void motor_get_dir(int8_t *left, int8_t *right);
+
+#endif // MOTOR_H
@@ -0,0 +1,144 @@
+#include "params.h"
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+/* ---------- Hand-tuned defaults (used until a calibration is saved) ---------- */
+#define DEFAULT_PIVOT_MS_90_LEFT   250
+#define DEFAULT_PIVOT_MS_90_RIGHT  235
+#define DEFAULT_TURNBACK_BIAS_DEG    5
+#define DEFAULT_DRIVE_MS           500
+#define DEFAULT_WHEEL_CIRCUM_MM    58.94f
+#define DEFAULT_COUNTS_PER_REV     80
+#define DEFAULT_TRACK_WIDTH_MM     120.0f
+#define DEFAULT_FULL_SPEED_TPS     250
+
+/* ---------- Flash block: last sector, clear of the program image ---------- */
+#define PARAMS_FLASH_OFFSET  (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define PARAMS_MAGIC         0x52505231u   // "RPR1"
+#define PARAMS_VERSION       2        // 2: bias_measured
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    RoverParams p;
+    uint32_t crc;
+} ParamBlock;
+
+_Static_assert(sizeof(ParamBlock) <= FLASH_PAGE_SIZE, "param block must fit one flash page");
+
+static RoverParams P;
+
+static uint32_t crc32(const uint8_t *d, size_t n) {
+    uint32_t c = 0xFFFFFFFFu;
+    while (n--) {
+        c ^= *d++;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+    }
+    return ~c;
+}
+
+static bool plausible(const RoverParams *p) {
+    return p->pivot_ms_90_left  >= 50 && p->pivot_ms_90_left  <= 2000 &&
+           p->pivot_ms_90_right >= 50 && p->pivot_ms_90_right <= 2000 &&
+           p->turnback_bias_deg >= -30 && p->turnback_bias_deg <= 30 &&
+           p->drive_ms >= 50 && p->drive_ms <= 5000 &&
+           p->wheel_circum_mm > 10.0f && p->wheel_circum_mm < 1000.0f &&
+           p->counts_per_rev > 0 && p->bias_measured <= 1 &&
+           p->track_width_mm > 20.0f && p->track_width_mm < 1000.0f;
+}
+
+/* runs with interrupts off / other core locked out (flash_safe_execute) */
+static void write_block(void *arg) {
+    flash_range_erase(PARAMS_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(PARAMS_FLASH_OFFSET, (const uint8_t *)arg, FLASH_PAGE_SIZE);
+}
+
+/* Version 1 ended before bias_measured. Its bias came from calib_est
+ * unless the block is just the defaults that "calib_defaults" saves. */
+static bool load_v1(const ParamBlock *b) {
+    const size_t v1_size = offsetof(RoverParams, bias_measured);
+    if (b->magic != PARAMS_MAGIC || b->version != 1 || b->size != v1_size ||
+        *(const uint32_t *)((const uint8_t *)&b->p + v1_size) != crc32((const uint8_t *)&b->p, v1_size))
+        return false;
+
+    RoverParams p, def;
+    params_defaults(&def);
+    memcpy(&p, &def, sizeof p);
+    memcpy(&p, &b->p, v1_size);
+    if (!p.full_speed_tps) p.full_speed_tps = DEFAULT_FULL_SPEED_TPS;
+    p.bias_measured = memcmp(&p, &def, v1_size) != 0;
+    if (!plausible(&p)) return false;
+    P = p;
+    return true;
+}
+
+/* ---------------- Public API ---------------- */
+void params_defaults(RoverParams *p) {
+    memset(p, 0, sizeof *p);
+    p->pivot_ms_90_left  = DEFAULT_PIVOT_MS_90_LEFT;
+    p->pivot_ms_90_right = DEFAULT_PIVOT_MS_90_RIGHT;
+    p->turnback_bias_deg = DEFAULT_TURNBACK_BIAS_DEG;
+    p->drive_ms          = DEFAULT_DRIVE_MS;
+    p->wheel_circum_mm   = DEFAULT_WHEEL_CIRCUM_MM;
+    p->counts_per_rev    = DEFAULT_COUNTS_PER_REV;
+    p->track_width_mm    = DEFAULT_TRACK_WIDTH_MM;
+    p->full_speed_tps    = DEFAULT_FULL_SPEED_TPS;
+}
+
+void params_load(void) {
+    const ParamBlock *b = (const ParamBlock *)(XIP_BASE + PARAMS_FLASH_OFFSET);
+
+    if (b->magic == PARAMS_MAGIC && b->version == PARAMS_VERSION &&
+        b->size == sizeof(RoverParams) &&
+        b->crc == crc32((const uint8_t *)&b->p, sizeof b->p) &&
+        plausible(&b->p)) {
+        P = b->p;
+        if (!P.full_speed_tps) P.full_speed_tps = DEFAULT_FULL_SPEED_TPS;   // saved before the field existed
+        printf("Params loaded from flash.\n");
+    } else if (load_v1(b)) {
+        printf("Params loaded from flash (version 1).\n");
+    } else {
+        params_defaults(&P);
+        printf("Params: no valid flash block, using defaults.\n");
+    }
+    printf("  pivot90 L/R=%u/%u ms | bias=%d deg %s | drive=%u ms | circum=%.2f mm | track=%.1f mm | full=%u t/s\n",
+           P.pivot_ms_90_left, P.pivot_ms_90_right, P.turnback_bias_deg,
+           P.bias_measured ? "drift" : "both sides", P.drive_ms,
+           P.wheel_circum_mm, P.track_width_mm, P.full_speed_tps);
+}
+
+const RoverParams *params_get(void) {
+    return &P;
+}
+
+void params_set(const RoverParams *p) {
+    P = *p;
+}
+
+bool params_save(void) {
+    if (!plausible(&P)) return false;
+
+    static uint8_t page[FLASH_PAGE_SIZE];
+    ParamBlock b = {
+        .magic = PARAMS_MAGIC,
+        .version = PARAMS_VERSION,
+        .size = sizeof(RoverParams),
+        .p = P,
+        .crc = crc32((const uint8_t *)&P, sizeof P),
+    };
+    memset(page, 0xFF, sizeof page);
+    memcpy(page, &b, sizeof b);
+
+    int rc = flash_safe_execute(write_block, page, 100);
+    if (rc != PICO_OK) {
+        printf("Params: flash write failed, rc=%d\n", rc);
+        return false;
+    }
+    printf("Params saved to flash.\n");
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Tunables that used to be #defines in ultrasonic.c / encoder.c / mission.c.
+// Written by the calibration routine (calib.c) and kept in the last flash
+// sector, so they survive reboots without reflashing.
+typedef struct {
+    uint16_t pivot_ms_90_left;   // ms that gives ~90° when pivoting LEFT
+    uint16_t pivot_ms_90_right;  // ms that gives ~90° when pivoting RIGHT
+    int16_t  turnback_bias_deg;  // see bias_measured
+    uint16_t drive_ms;           // avoidance side-step drive time
+    float    wheel_circum_mm;
+    uint16_t counts_per_rev;     // encoder slots, fixed by the disc
+    uint16_t full_speed_tps;     // encoder ticks/s per wheel at full duty (stall.c)
+    float    track_width_mm;     // wheel centre-to-centre distance
+    uint8_t  bias_measured;      // 1: turnback_bias_deg is the heading drift per
+                                 //    side-step from calib, + = left (CCW)
+                                 // 0: hand-tuned, added to both turn-backs
+} RoverParams;
+
+// Call once at boot, before the drivers use the parameters.
+// Falls back to the built-in defaults if flash is blank or corrupt.
+void params_load(void);
+
+// Current values (RAM copy).
+const RoverParams *params_get(void);
+
+// Replace the RAM copy; call params_save() to make it stick.
+void params_set(const RoverParams *p);
+
+// Built-in (hand-tuned) values.
+void params_defaults(RoverParams *p);
+
+// Write the RAM copy to flash. Stop the motors first: interrupts are
+// held off for the sector erase. Returns false if the write failed.
+bool params_save(void);
+
+#endif // PARAMS_H
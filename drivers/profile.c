@@ -0,0 +1,133 @@
+#include "profile.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "motor.h"
+
+/* ---------- S-curve step table ----------
+ * smootherstep 6t^5 - 15t^4 + 10t^3 sampled at CURVE_SEGS+1 points (Q15).
+ * Slope and curvature are zero at both ends, so acceleration and jerk
+ * stay bounded; peak accel = 1.875 * VMAX / PROFILE_RAMP_MS.
+ */
+#define CURVE_SEGS 32
+static const uint16_t S_CURVE[CURVE_SEGS + 1] = {
+        0,    10,    73,   233,   526,   975,  1598,  2403,
+     3392,  4560,  5898,  7390,  9018, 10757, 12583, 14469,
+    16384, 18298, 20184, 22010, 23749, 25377, 26869, 28207,
+    29375, 30364, 31169, 31792, 32241, 32534, 32694, 32757,
+    32767
+};
+
+/* Carried-rate term h(t) = t(1-t)^3(1+3t), Q16 (peak 0.198 at t = 1/3).
+ * Unit slope at t=0, zero slope and curvature at both ends: added to the
+ * S-curve it starts a ramp at the rate the output already had, so a new
+ * target mid-ramp does not drop the acceleration to zero in one tick. */
+static const uint16_t H_CURVE[CURVE_SEGS + 1] = {
+        0,  2036,  4008,  5859,  7546,  9034, 10298, 11322,
+    12096, 12618, 12894, 12933, 12750, 12365, 11801, 11083,
+    10240,  9301,  8296,  7256,  6210,  5186,  4211,  3308,
+     2496,  1792,  1207,   745,   406,   182,    57,     8,
+        0
+};
+
+#define RAMP_TICKS_FULL  (PROFILE_RAMP_MS / PROFILE_TICK_MS)
+#define PHASE_END        ((uint32_t)CURVE_SEGS << 16)
+
+/* Ticks to wind a carried rate (per tick) down to zero: h'' peaks at 3.94,
+ * the S-curve's at 5.77 over a full ramp, so T >= 0.683 * RAMP_TICKS_FULL^2
+ * * rate / VMAX keeps the carried part's jerk within a full ramp's. */
+#define CARRY_TICKS_NUM  (RAMP_TICKS_FULL * RAMP_TICKS_FULL * 683u / 1000u)
+
+/* one per wheel; phase is a Q16 index into S_CURVE / H_CURVE */
+typedef struct {
+    int16_t from, to, out;
+    int16_t prev;            // out one tick ago (its rate is out - prev)
+    int32_t carry;           // carried rate * ramp ticks, scales H_CURVE
+    uint32_t phase;
+    uint32_t step;
+} Ramp;
+
+static Ramp R[2] = {         // [0]=left, [1]=right
+    {.phase = PHASE_END}, {.phase = PHASE_END}
+};
+
+/* Start a new ramp from the current output and its rate. The divisions
+ * live here (only on a target change); the per-tick path is adds, shifts
+ * and table lookups. Duration scales with |delta| so accel is the same for
+ * a gentle change and a full reversal, and is stretched if the rate being
+ * carried needs longer to wind down. */
+static void ramp_retarget(Ramp *r, int16_t to) {
+    if (to == r->to) return;
+    int32_t delta = (int32_t)to - r->out;
+    if (delta < 0) delta = -delta;
+    int32_t rate = (r->phase < PHASE_END) ? (int32_t)r->out - r->prev : 0;
+    uint32_t mag = (uint32_t)(rate < 0 ? -rate : rate);
+
+    uint32_t ticks = ((uint32_t)RAMP_TICKS_FULL * (uint32_t)delta + PROFILE_VMAX - 1) / PROFILE_VMAX;
+    uint32_t wind = (CARRY_TICKS_NUM * mag + PROFILE_VMAX - 1) / PROFILE_VMAX;
+    if (ticks < wind) ticks = wind;
+    if (ticks == 0) ticks = 1;
+
+    r->from = r->out;
+    r->to = to;
+    r->carry = rate * (int32_t)ticks;
+    r->phase = 0;
+    r->step = PHASE_END / ticks;
+}
+
+static inline int32_t curve_at(const uint16_t *c, uint32_t i, int32_t frac) {
+    return c[i] + ((((int32_t)c[i + 1] - c[i]) * frac) >> 16);
+}
+
+static inline void ramp_step(Ramp *r) {
+    r->prev = r->out;
+    if (r->phase >= PHASE_END) return;
+    r->phase += r->step;
+    if (r->phase >= PHASE_END) { r->out = r->to; return; }
+
+    uint32_t i = r->phase >> 16;
+    int32_t frac = (int32_t)(r->phase & 0xFFFF);
+    int32_t v = r->from + ((((int32_t)r->to - r->from) * curve_at(S_CURVE, i, frac)) >> 15)
+                        + (int32_t)(((int64_t)r->carry * curve_at(H_CURVE, i, frac)) >> 16);
+    if (v > PROFILE_VMAX) v = PROFILE_VMAX;
+    if (v < -PROFILE_VMAX) v = -PROFILE_VMAX;
+    r->out = (int16_t)v;
+}
+
+static bool profile_cb(repeating_timer_t *t) {
+    ramp_step(&R[0]);
+    ramp_step(&R[1]);
+    motor_write(R[0].out, R[1].out);
+    return true; // keep repeating
+}
+
+/* ---------------- Public API ---------------- */
+void profile_init(void) {
+    static repeating_timer_t timer;
+    add_repeating_timer_ms(PROFILE_TICK_MS, profile_cb, NULL, &timer);
+}
+
+void profile_set_target(int16_t left, int16_t right) {
+    uint32_t irq = save_and_disable_interrupts();
+    ramp_retarget(&R[0], left);
+    ramp_retarget(&R[1], right);
+    restore_interrupts(irq);
+}
+
+void profile_halt(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    for (int i = 0; i < 2; i++) {
+        R[i].from = R[i].to = R[i].out = R[i].prev = 0;
+        R[i].carry = 0;
+        R[i].phase = PHASE_END;
+    }
+    restore_interrupts(irq);
+}
+
+void profile_get_output(int16_t *left, int16_t *right) {
+    *left = R[0].out;
+    *right = R[1].out;
+}
+
+bool profile_busy(void) {
+    return R[0].phase < PHASE_END || R[1].phase < PHASE_END;
+}
@@ -0,0 +1,32 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Wheel velocity scale: Q15 fraction of full duty, sign = direction
+#define PROFILE_VMAX       32767
+
+// Time for a 0 -> full speed ramp; a full reversal takes twice as long
+#define PROFILE_RAMP_MS    120
+#define PROFILE_TICK_MS    2
+
+// Call once in main() after motor_init_pins(); starts the ramp timer.
+void profile_init(void);
+
+// New per-wheel velocity targets (-PROFILE_VMAX..PROFILE_VMAX).
+// The output S-curves from where it is now, keeping the rate it is
+// changing at, so retargeting mid-ramp stays smooth; safe to call every loop.
+void profile_set_target(int16_t left, int16_t right);
+
+// Drop targets and outputs to zero at once (no ramp). ISR-safe;
+// used by motor_halt().
+void profile_halt(void);
+
+// Velocity currently being sent to the motors.
+void profile_get_output(int16_t *left, int16_t *right);
+
+// True while either wheel is still ramping towards its target.
+bool profile_busy(void);
+
+#endif // PROFILE_H
@@ -0,0 +1,194 @@
+#include "stall.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "motor.h"
+#include "profile.h"
+#include "encoder.h"
+#include "params.h"
+#include "ultrasonic.h"
+#include "mission.h"
+#include "calib.h"
+
+/* ---------- Detection thresholds ---------- */
+#define MIN_CMD           (PROFILE_VMAX / 4)   // below ~25% duty a wheel may not turn at all
+#define STEADY_TOL        (PROFILE_VMAX / 16)  // command change that restarts the settle time
+#define SETTLE_MS         150    // ramp (PROFILE_RAMP_MS) + motor spin-up before judging
+#define WINDOW_TICKS      5      // rate window = WINDOW_TICKS * STALL_TICK_MS
+#define STALL_EDGES       4      // expected edge periods with no edge = stall...
+#define STALL_MIN_MS      40     // ...clamped to this range
+#define STALL_MAX_MS      150
+#define SLIP_NUM          8      // slip: rate > 8/5 of expected...
+#define SLIP_DEN          5
+#define SLIP_CONFIRM      3      // ...for this many ticks in a row
+#define DRAG_NUM          1      // drag: normalised rate < 1/2 of the other wheel's...
+#define DRAG_DEN          2
+#define DRAG_CONFIRM      5      // ...for this many ticks in a row
+#define DEFAULT_BACKOFF_MS 400
+
+typedef enum { WS_IDLE=0, WS_OK, WS_STALL, WS_SLIP, WS_DRAG } WheelState;
+
+typedef struct {
+    int16_t  cmd;                  // command at the start of the steady period
+    uint16_t steady_ms;
+    uint32_t hist[WINDOW_TICKS];   // tick totals, oldest at head
+    uint8_t  head;
+    uint8_t  slip_n;
+    uint8_t  state;
+    uint16_t tps, exp_tps;         // measured / expected ticks per second
+} Wheel;
+
+static Wheel W[2];                 // [0]=left, [1]=right
+static uint8_t drag_n = 0;
+
+static volatile uint8_t recovery = STALL_REC_AVOID;
+static volatile uint16_t backoff_ms = DEFAULT_BACKOFF_MS;
+
+static volatile bool event_pending = false;
+static volatile bool held = false;         // stopped until stall_release()
+static volatile uint8_t event_side = 0;    // 0 left, 1 right, 2 both
+static volatile uint32_t stall_count = 0;
+static volatile uint32_t last_stall_ms = 0;
+
+static const char *SIDE_NAMES[] = {"left", "right", "both"};
+
+/* ---------------- Per-wheel checks ---------------- */
+static void judge(Wheel *w, int16_t cmd, uint32_t ticks, uint32_t edge_us, uint32_t now_us) {
+    int32_t mag = cmd < 0 ? -cmd : cmd;
+    int32_t change = (int32_t)cmd - w->cmd;
+    if (change < 0) change = -change;
+    /* below MIN_CMD the wheel may be barely turning: settle afresh from
+     * the moment it is commanded above, however small that step was */
+    if (change > STEADY_TOL || mag < MIN_CMD) { w->cmd = cmd; w->steady_ms = 0; }
+    else if (w->steady_ms < SETTLE_MS) w->steady_ms += STALL_TICK_MS;
+
+    uint32_t oldest = w->hist[w->head];
+    w->hist[w->head] = ticks;
+    w->head = (uint8_t)((w->head + 1) % WINDOW_TICKS);
+    w->tps = (uint16_t)((ticks - oldest) * 1000u / (WINDOW_TICKS * STALL_TICK_MS));
+    w->exp_tps = (uint16_t)((uint32_t)params_get()->full_speed_tps * (uint32_t)mag / PROFILE_VMAX);
+
+    if (mag < MIN_CMD || w->steady_ms < SETTLE_MS || w->exp_tps == 0) {
+        w->state = WS_IDLE;
+        w->slip_n = 0;
+        return;
+    }
+
+    /* Stall goes by the last edge, not the windowed rate: it fires as soon
+     * as an edge is a few periods late instead of after a whole window. */
+    uint32_t limit = STALL_EDGES * 1000u / w->exp_tps;
+    if (limit < STALL_MIN_MS) limit = STALL_MIN_MS;
+    if (limit > STALL_MAX_MS) limit = STALL_MAX_MS;
+    if ((now_us - edge_us) / 1000u > limit) {
+        w->state = WS_STALL;
+        w->slip_n = 0;
+        return;
+    }
+
+    if ((uint32_t)w->tps * SLIP_DEN > (uint32_t)w->exp_tps * SLIP_NUM) {
+        if (w->slip_n < SLIP_CONFIRM) w->slip_n++;
+    } else {
+        w->slip_n = 0;
+    }
+    w->state = (w->slip_n >= SLIP_CONFIRM) ? WS_SLIP : WS_OK;
+}
+
+/* both wheels turning, but one far slower than its command says it should */
+static void judge_drag(void) {
+    if (W[0].state != WS_OK || W[1].state != WS_OK) { drag_n = 0; return; }
+
+    uint32_t nl = (uint32_t)W[0].tps * 1000u / W[0].exp_tps;   // 1000 = as expected
+    uint32_t nr = (uint32_t)W[1].tps * 1000u / W[1].exp_tps;
+    if (nl * DRAG_DEN < nr * DRAG_NUM || nr * DRAG_DEN < nl * DRAG_NUM) {
+        if (drag_n < DRAG_CONFIRM) drag_n++;
+    } else {
+        drag_n = 0;
+    }
+    if (drag_n >= DRAG_CONFIRM) W[nl < nr ? 0 : 1].state = WS_DRAG;
+}
+
+static bool stall_cb(repeating_timer_t *t) {
+    uint32_t now_us = time_us_32();
+    uint32_t tl, tr, el, er;
+    int16_t cl, cr;
+    encoder_get_ticks(&tl, &tr);
+    encoder_get_last_edge_us(&el, &er);
+    profile_get_output(&cl, &cr);
+
+    bool was_l = W[0].state == WS_STALL, was_r = W[1].state == WS_STALL;
+    judge(&W[0], cl, tl, el, now_us);
+    judge(&W[1], cr, tr, er, now_us);
+    judge_drag();
+
+    bool new_l = W[0].state == WS_STALL && !was_l;
+    bool new_r = W[1].state == WS_STALL && !was_r;
+    if (new_l || new_r) {
+        stall_count++;
+        last_stall_ms = to_ms_since_boot(get_absolute_time());
+        event_side = (new_l && new_r) ? 2 : (new_r ? 1 : 0);
+        if (recovery != STALL_REC_OFF) {
+            motor_halt(MOTOR_COAST);   // now, not whenever the main loop comes round
+            event_pending = true;
+        }
+    }
+    return true; // keep repeating
+}
+
+/* ---------------- Public API ---------------- */
+void stall_init(void) {
+    static repeating_timer_t timer;
+    add_repeating_timer_ms(STALL_TICK_MS, stall_cb, NULL, &timer);
+}
+
+void stall_set_recovery(StallRecovery mode, uint16_t ms) {
+    recovery = (uint8_t)mode;
+    if (ms) backoff_ms = ms;
+    if (mode == STALL_REC_OFF) held = false;
+}
+
+bool stall_service(void) {
+    if (!event_pending) return held;
+    event_pending = false;
+
+    printf("[stall] %s wheel not turning\n", SIDE_NAMES[event_side]);
+    calib_abort();
+    if (recovery == STALL_REC_AVOID && !ultra_is_avoiding()) {
+        printf("[stall] backing off %u ms, then side-stepping\n", (unsigned)backoff_ms);
+        ultra_start_recovery(backoff_ms);
+    } else {
+        /* STOP mode, or stuck again while already avoiding/recovering */
+        ultra_cancel_avoidance();
+        mission_abort();
+        held = true;
+        printf("[stall] stopped until a new command\n");
+    }
+    return true;
+}
+
+bool stall_pending(void) {
+    return event_pending;
+}
+
+void stall_release(void) {
+    held = false;
+}
+
+int stall_format_status(char *buf, size_t n) {
+    static const char *NAMES[] = {"idle", "ok", "stall", "slip", "drag"};
+    static const char *REC_NAMES[] = {"off", "stop", "avoid"};
+    if (n == 0) return 0;
+
+    int len = snprintf(buf, n, "S: L=%s %u/%u R=%s %u/%u t/s | stalls=%lu",
+                       NAMES[W[0].state], W[0].tps, W[0].exp_tps,
+                       NAMES[W[1].state], W[1].tps, W[1].exp_tps,
+                       (unsigned long)stall_count);
+    if (len > 0 && len < (int)n && stall_count) {
+        uint32_t ago = to_ms_since_boot(get_absolute_time()) - last_stall_ms;
+        len += snprintf(buf + len, n - len, " last=%s %.1f s ago",
+                        SIDE_NAMES[event_side], ago / 1000.0);
+    }
+    if (len > 0 && len < (int)n)
+        len += snprintf(buf + len, n - len, " | rec=%s%s\r\n", REC_NAMES[recovery],
+                        held ? " held" : "");
+    if (len < 0) return 0;
+    return (len < (int)n) ? len : (int)n - 1;
+}
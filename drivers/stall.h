@@ -0,0 +1,49 @@
+#ifndef STALL_H
+#define STALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Wheel stall / slip / drag detection: the profile output for each wheel
+// against what its encoder is doing, checked every STALL_TICK_MS from a
+// timer so it does not wait on the (slow) main loop.
+//   stall - commanded to move, but no encoder edge for too long
+//   slip  - turning much faster than the command asks (lifted, spinning)
+//   drag  - one wheel well behind the other relative to their commands
+// Only a stall triggers recovery; slip and drag are reported.
+
+#define STALL_TICK_MS     10
+
+typedef enum {
+    STALL_REC_OFF = 0,   // detect and report only
+    STALL_REC_STOP,      // cut the motors, drop any mission, hold until a new command
+    STALL_REC_AVOID      // cut the motors, back off, then side-step (default)
+} StallRecovery;
+
+// Call once in main() after profile_init() and encoder_init().
+void stall_init(void);
+
+// Recovery on a stall; backoff_ms is the reverse time for STALL_REC_AVOID.
+// Safe from the UDP callback.
+void stall_set_recovery(StallRecovery mode, uint16_t backoff_ms);
+
+// Call every main-loop pass, before anything else drives the motors.
+// The timer has already cut the motors; this runs the rest of the recovery.
+// Returns true when nothing else may drive this pass: a stall was handled
+// just now, or a stop is being held (STOP mode, or stuck again while
+// avoiding) until stall_release().
+bool stall_service(void);
+
+// True from the timer's halt until stall_service() has dealt with it.
+// For code that reads sensors between stall_service() and driving.
+bool stall_pending(void);
+
+// Lift a held stop. Call when the operator sends a different command;
+// keepalives repeating the one that stalled must not restart it.
+void stall_release(void);
+
+// One "S: ..." telemetry line. Returns chars written.
+int stall_format_status(char *buf, size_t n);
+
+#endif // STALL_H
@@ -0,0 +1,328 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/async_context.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "encoder.h"
+#include "ultrasonic.h"
+#include "mission.h"
+#include "calib.h"
+#include "stall.h"
+#include "params.h"
+#include "diag.h"
+
+/* ---------- Scheduler ---------- */
+#define TELEM_TICK_MS          10     // resolution of the per-subscriber periods
+#define LEGACY_PERIOD_MS       500    // old fixed PRINT_MS stream
+#define LEGACY_LEASE_MS        30000  // long enough to cover a one-shot mission upload
+#define ODOM_WINDOW_MS         LEGACY_PERIOD_MS   // odom ticks= and rates are over this
+
+static const char *CHANNEL_NAMES[TELEM_CHANNEL_COUNT] = {"odom", "range", "fsm", "diag"};
+
+/* one per channel a subscriber takes, each with its own rate and lease */
+typedef struct {
+    uint32_t period_ms;     // 0 = not subscribed
+    uint32_t next_ms;
+    uint32_t expires_ms;
+} ChanSub;
+
+/* one per subscriber (address, port) */
+typedef struct {
+    bool used;
+    bool ctrl;              // has sent control packets (telemetry_touch)
+    u16_t port;
+    ip_addr_t addr;
+    ChanSub ch[TELEM_CHANNEL_COUNT];
+} Sub;
+
+static Sub subs[TELEM_MAX_SUBS];
+static struct udp_pcb *telem_pcb = NULL;
+static async_at_time_worker_t telem_worker;
+
+/* encoded once per sample, then handed to every due subscriber */
+static char sample_buf[768];
+
+static inline uint32_t now_ms(void) { return to_ms_since_boot(get_absolute_time()); }
+static inline bool reached(uint32_t now, uint32_t t) { return (int32_t)(now - t) >= 0; }
+
+/* ---------------- Channel encoders ---------------- */
+/* Encoder totals at every tick for the last ODOM_WINDOW_MS; odom rates are
+ * over that window, so they read the same to every subscriber whatever
+ * rates the others have asked for. */
+#define ODOM_SNAPS (ODOM_WINDOW_MS / TELEM_TICK_MS)
+
+typedef struct { uint32_t l, r, ms; } OdomSnap;
+
+static OdomSnap odom_hist[ODOM_SNAPS];
+static unsigned odom_head;      // oldest snapshot, overwritten next
+
+static void odom_record(uint32_t now) {
+    OdomSnap *o = &odom_hist[odom_head];
+    encoder_get_ticks(&o->l, &o->r);
+    o->ms = now;
+    odom_head = (odom_head + 1) % ODOM_SNAPS;
+}
+
+static int encode_odom(char *buf, size_t n, uint32_t now) {
+    const OdomSnap *o = &odom_hist[odom_head];
+    uint32_t tl, tr;
+    encoder_get_ticks(&tl, &tr);
+    uint32_t dl = tl - o->l, dr = tr - o->r;
+    double dt = (now - o->ms) / 1000.0;
+    if (dt <= 0.0) dt = TELEM_TICK_MS / 1000.0;
+
+    const double mpt = encoder_mm_per_tick();
+    const double cpr = params_get()->counts_per_rev;
+    return snprintf(buf, n,
+        "L: ticks=%-4lu | rpm=%-6.1f | speed=%-5.1f mm/s | total=%.1f mm\r\n"
+        "R: ticks=%-4lu | rpm=%-6.1f | speed=%-5.1f mm/s | total=%.1f mm\r\n---\r\n",
+        (unsigned long)dl, dl / cpr / dt * 60.0, dl * mpt / dt, tl * mpt,
+        (unsigned long)dr, dr / cpr / dt * 60.0, dr * mpt / dt, tr * mpt);
+}
+
+static int encode_range(char *buf, size_t n, uint32_t now) {
+    return snprintf(buf, n, "U: range=%lu cm\r\n", (unsigned long)ultra_last_cm());
+}
+
+static int encode_fsm(char *buf, size_t n, uint32_t now) {
+    int len = ultra_format_status(buf, n);
+    len += stall_format_status(buf + len, n - len);
+    len += mission_format_status(buf + len, n - len);
+    len += calib_format_status(buf + len, n - len);
+    return len;
+}
+
+static int encode_diag(char *buf, size_t n, uint32_t now) {
+    return diag_format(buf, n);
+}
+
+static int (*const ENCODERS[TELEM_CHANNEL_COUNT])(char *, size_t, uint32_t) = {
+    encode_odom, encode_range, encode_fsm, encode_diag
+};
+
+/* a subscriber with no channels left frees its slot */
+static void drop_if_idle(Sub *s) {
+    for (int c = 0; c < TELEM_CHANNEL_COUNT; c++)
+        if (s->ch[c].period_ms) return;
+    s->used = false;
+}
+
+/* ---------------- Fan-out ---------------- */
+/* The payload pbuf is allocated with no header room (PBUF_RAW), so each
+ * udp_sendto() puts the UDP/IP headers in a small pbuf of its own and
+ * chains our payload behind it by reference. Every subscriber shares the
+ * one copy of the text, and a packet parked on ARP keeps its own headers. */
+static void publish(TelemChannel ch, uint32_t now) {
+    bool due = false;
+    for (int i = 0; i < TELEM_MAX_SUBS; i++) {
+        Sub *s = &subs[i];
+        ChanSub *c = &s->ch[ch];
+        if (!s->used || !c->period_ms) continue;
+        if (reached(now, c->expires_ms)) {
+            c->period_ms = 0;
+            drop_if_idle(s);
+            printf("[telem] %s lease expired for %s:%u\n",
+                   CHANNEL_NAMES[ch], ipaddr_ntoa(&s->addr), s->port);
+            continue;
+        }
+        if (reached(now, c->next_ms)) due = true;
+    }
+    if (!due) return;
+
+    int len = ENCODERS[ch](sample_buf, sizeof(sample_buf), now);
+    if (len < 0) return;
+    if (len >= (int)sizeof(sample_buf)) len = sizeof(sample_buf) - 1;
+
+    struct pbuf *p = NULL;
+    if (len > 0) {
+        p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+        if (!p) {
+            diag_count(DIAG_TELEM_ALLOC_FAIL);
+            return;                 // subscribers stay due; retried next tick
+        }
+        memcpy(p->payload, sample_buf, len);
+    }
+
+    for (int i = 0; i < TELEM_MAX_SUBS; i++) {
+        Sub *s = &subs[i];
+        ChanSub *c = &s->ch[ch];
+        if (!s->used || !c->period_ms || !reached(now, c->next_ms)) continue;
+        if (p && udp_sendto(telem_pcb, p, &s->addr, s->port) != ERR_OK)
+            diag_count(DIAG_TELEM_SEND_FAIL);
+        c->next_ms += c->period_ms;
+        if (reached(now, c->next_ms)) c->next_ms = now + c->period_ms;   // fell behind: don't burst
+    }
+    if (p) pbuf_free(p);
+}
+
+static void telem_work(async_context_t *ctx, async_at_time_worker_t *w) {
+    uint32_t now = now_ms();
+    for (int c = 0; c < TELEM_CHANNEL_COUNT; c++) publish((TelemChannel)c, now);
+    odom_record(now);
+    async_context_add_at_time_worker_in_ms(ctx, w, TELEM_TICK_MS);
+}
+
+/* ---------------- Subscription table ---------------- */
+static Sub *find(const ip_addr_t *addr, u16_t port) {
+    for (int i = 0; i < TELEM_MAX_SUBS; i++) {
+        Sub *s = &subs[i];
+        if (s->used && s->port == port && ip_addr_cmp(&s->addr, addr)) return s;
+    }
+    return NULL;
+}
+
+/* a free slot; listeners leave the last TELEM_CTRL_SUBS to controllers */
+static Sub *alloc(bool ctrl) {
+    Sub *s = NULL;
+    int listeners = 0;
+    for (int i = 0; i < TELEM_MAX_SUBS; i++) {
+        if (!subs[i].used) { if (!s) s = &subs[i]; }
+        else if (!subs[i].ctrl) listeners++;
+    }
+    if (!ctrl && listeners >= TELEM_MAX_SUBS - TELEM_CTRL_SUBS) return NULL;
+    return s;
+}
+
+/* add or renew; a renewal keeps the current phase of the period */
+static bool subscribe(const ip_addr_t *addr, u16_t port, int ch, uint32_t period_ms, uint32_t lease_ms, bool ctrl) {
+    uint32_t now = now_ms();
+    Sub *s = find(addr, port);
+    if (!s) {
+        s = alloc(ctrl);
+        if (!s) return false;
+        memset(s, 0, sizeof *s);
+        s->used = true;
+        s->port = port;
+        ip_addr_copy(s->addr, *addr);
+    }
+    ChanSub *c = &s->ch[ch];
+    if (!c->period_ms || period_ms < c->period_ms) c->next_ms = now;
+    c->period_ms = period_ms;
+    c->expires_ms = now + lease_ms;
+    return true;
+}
+
+static int unsubscribe(const ip_addr_t *addr, u16_t port, int ch) {
+    Sub *s = find(addr, port);
+    if (!s) return 0;
+    int n = 0;
+    for (int c = 0; c < TELEM_CHANNEL_COUNT; c++) {
+        if (ch != TELEM_CHANNEL_COUNT && ch != c) continue;
+        if (s->ch[c].period_ms) { s->ch[c].period_ms = 0; n++; }
+    }
+    drop_if_idle(s);
+    return n;
+}
+
+/* ---------------- Command parsing ---------------- */
+static const char *skip_ws(const char *s) {
+    while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
+    return s;
+}
+
+/* channel index, TELEM_CHANNEL_COUNT for "all", -1 if unknown */
+static int parse_channel(const char **s) {
+    const char *p = skip_ws(*s);
+    size_t m = strcspn(p, " \t\r\n");
+    if (m == 3 && strncmp(p, "all", 3) == 0) { *s = p + m; return TELEM_CHANNEL_COUNT; }
+    for (int c = 0; c < TELEM_CHANNEL_COUNT; c++) {
+        if (m == strlen(CHANNEL_NAMES[c]) && strncmp(p, CHANNEL_NAMES[c], m) == 0) {
+            *s = p + m;
+            return c;
+        }
+    }
+    return -1;
+}
+
+/* optional trailing number; keeps *v if absent */
+static bool parse_opt(const char **s, long *v, long lo, long hi) {
+    char *end;
+    long x = strtol(*s, &end, 10);
+    if (end == *s) return true;
+    if (x < lo || x > hi) return false;
+    *v = x;
+    *s = end;
+    return true;
+}
+
+static void reply(const ip_addr_t *addr, u16_t port, const char *text) {
+    int len = strlen(text);
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if (!p) {
+        diag_count(DIAG_TELEM_ALLOC_FAIL);
+        return;
+    }
+    memcpy(p->payload, text, len);
+    if (udp_sendto(telem_pcb, p, addr, port) != ERR_OK) diag_count(DIAG_TELEM_SEND_FAIL);
+    pbuf_free(p);
+}
+
+/* ---------------- Public API ---------------- */
+void telemetry_init(struct udp_pcb *pcb) {
+    telem_pcb = pcb;
+    uint32_t now = now_ms();
+    for (unsigned i = 0; i < ODOM_SNAPS; i++) odom_record(now);
+    telem_worker.do_work = telem_work;
+    async_context_add_at_time_worker_in_ms(cyw43_arch_async_context(), &telem_worker, TELEM_TICK_MS);
+}
+
+bool telemetry_handle_cmd(const char *buf, const ip_addr_t *addr, u16_t default_port) {
+    bool sub = strncmp(buf, "sub ", 4) == 0;
+    if (!sub && strncmp(buf, "unsub ", 6) != 0) return false;
+
+    const char *p = buf + (sub ? 4 : 6);
+    long period = 0, lease = TELEM_DEFAULT_LEASE_MS, port = default_port;
+    char msg[96];
+
+    int ch = parse_channel(&p);
+    bool ok = ch >= 0;
+    if (ok && sub) {
+        char *end;
+        period = strtol(p, &end, 10);
+        ok = end != p && period >= TELEM_MIN_PERIOD_MS && period <= TELEM_MAX_LEASE_MS;
+        p = end;
+        ok = ok && parse_opt(&p, &lease, 1, TELEM_MAX_LEASE_MS);
+    }
+    ok = ok && parse_opt(&p, &port, 1, 65535);
+    if (!ok) {
+        diag_count(DIAG_CTRL_REJECTED);
+        reply(addr, (u16_t)port, sub ? "sub rejected\r\n" : "unsub rejected\r\n");
+        return true;
+    }
+
+    if (!sub) {
+        int n = unsubscribe(addr, (u16_t)port, ch);
+        snprintf(msg, sizeof msg, "unsub ok %d\r\n", n);
+        reply(addr, (u16_t)port, msg);
+        return true;
+    }
+
+    int first = ch == TELEM_CHANNEL_COUNT ? 0 : ch;
+    int last = ch == TELEM_CHANNEL_COUNT ? TELEM_CHANNEL_COUNT - 1 : ch;
+    for (int c = first; c <= last; c++) {
+        if (subscribe(addr, (u16_t)port, c, (uint32_t)period, (uint32_t)lease, false))
+            snprintf(msg, sizeof msg, "sub ok %s %ld ms lease %ld ms\r\n", CHANNEL_NAMES[c], period, lease);
+        else
+            snprintf(msg, sizeof msg, "sub full %s\r\n", CHANNEL_NAMES[c]);
+        reply(addr, (u16_t)port, msg);
+    }
+    return true;
+}
+
+/* an explicit subscription on the same port keeps its own rate */
+void telemetry_touch(const ip_addr_t *addr, u16_t port) {
+    static const uint8_t LEGACY[] = {TELEM_ODOM, TELEM_FSM};
+    uint32_t expires = now_ms() + LEGACY_LEASE_MS;
+    for (size_t i = 0; i < sizeof LEGACY; i++) {
+        Sub *s = find(addr, port);
+        ChanSub *c = s ? &s->ch[LEGACY[i]] : NULL;
+        if (!c || !c->period_ms) subscribe(addr, port, LEGACY[i], LEGACY_PERIOD_MS, LEGACY_LEASE_MS, true);
+        else if (!reached(c->expires_ms, expires)) c->expires_ms = expires;
+    }
+    Sub *s = find(addr, port);
+    if (s) s->ctrl = true;    // a listener that starts driving no longer counts as one
+}
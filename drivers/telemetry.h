@@ -0,0 +1,46 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/ip_addr.h"
+
+struct udp_pcb;
+
+// Named streams a client can subscribe to
+typedef enum {
+    TELEM_ODOM = 0,    // "L:" / "R:" wheel ticks, rpm and speed over the last 500 ms, distance
+    TELEM_RANGE,       // "U:" last ultrasonic range
+    TELEM_FSM,         // "A:" avoidance, "S:" stall detector, plus "M:" / "C:" when active
+    TELEM_DIAG,        // diag_format() report
+    TELEM_CHANNEL_COUNT
+} TelemChannel;
+
+#define TELEM_MAX_SUBS        16      // subscribers, i.e. (address, port) pairs, any channels each
+#define TELEM_CTRL_SUBS       2       // of those, kept for controllers (telemetry_touch)
+#define TELEM_MIN_PERIOD_MS   20
+#define TELEM_MAX_LEASE_MS    60000
+#define TELEM_DEFAULT_LEASE_MS 10000
+
+// Call once in main() after the UDP server exists. Samples are sent from
+// pcb (so they come from the control port) by an async_context worker,
+// i.e. in the same context as lwIP itself.
+void telemetry_init(struct udp_pcb *pcb);
+
+// Handles "sub ..." / "unsub ..." from the UDP callback:
+//   sub <chan|all> <period_ms> [lease_ms] [port]
+//   unsub <chan|all> [port]
+// chan is odom, range, fsm or diag; port defaults to default_port.
+// Re-sending "sub" renews the lease. The result is acknowledged on the
+// subscriber's port. Returns false if buf is not a subscription command.
+bool telemetry_handle_cmd(const char *buf, const ip_addr_t *addr, u16_t default_port);
+
+// Implicit subscription for a controlling client: odom + fsm at the old
+// 500 ms rate, lease renewed by every control packet. Each controller
+// gets its own entry, so one client no longer steals another's stream.
+// "sub" from clients that never send control packets stops short of the
+// last TELEM_CTRL_SUBS entries, so a controller still gets its stream when
+// the table is full of listeners.
+void telemetry_touch(const ip_addr_t *addr, u16_t port);
+
+#endif // TELEMETRY_H
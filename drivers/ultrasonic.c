@@ -3,6 +3,10 @@
 #include "hardware/gpio.h"
 #include <stdio.h>
 #include "motor.h"
+#include "profile.h"
+#include "params.h"
+#include "stall.h"
+#include "diag.h"
 
 /* ---------- Clear/Stop thresholds ---------- */
 #define STOP_CM           30     
@@ -12,18 +16,15 @@
 #define TIMEOUT_ECHO_US   26000
 #define SAMPLE_COUNT      5
 
-/* ---------- Turning/drive calibration ---------- */
-#define PIVOT_MS_90_LEFT   250   // ms that gives ~90° when pivoting LEFT
-#define PIVOT_MS_90_RIGHT  235   // ms that gives ~90° when pivoting RIGHT
-#define TURNBACK_BIAS_DEG    5   // extra degrees on the turn-back to re-center (compensate drift)
-#define DRIVE_MS            500  // how far to slide per side step (increase if want bigger sidestep)
+/* ---------- Turning/drive timing ---------- */
+/* Pivot/side-step calibration lives in params.c (tuned by calib.c) */
 #define CHECK_PAUSE_MS      120  // settle before reading
 #define FORWARD_CLEAR_MS    650  // forward time once clear
 #define MAX_SIDE_STEPS       20  // safety cap
 
 /* ---------- helpers to convert degrees -> ms per side ---------- */
-static inline int ms_for_deg_left(int deg)  { return (deg * PIVOT_MS_90_LEFT)  / 90; }
-static inline int ms_for_deg_right(int deg) { return (deg * PIVOT_MS_90_RIGHT) / 90; }
+static inline int ms_for_deg_left(int deg)  { return (deg * params_get()->pivot_ms_90_left)  / 90; }
+static inline int ms_for_deg_right(int deg) { return (deg * params_get()->pivot_ms_90_right) / 90; }
 
 /* ---------------- Ultrasonic sampling ---------------- */
 static inline uint32_t pulse_us(void) {
@@ -52,34 +53,40 @@ void ultra_init(void) {
     gpio_init(ULTRA_ECHO_PIN); gpio_set_dir(ULTRA_ECHO_PIN, GPIO_IN);
 }
 
-uint32_t ultra_read_cm(void) {
+/* last median, kept for telemetry (0 = no echo) */
+static volatile uint32_t last_echo_us = 0;
+
+/* median echo time in us; 0 means invalid/timeout */
+static uint32_t read_median_us(void) {
     uint32_t v[SAMPLE_COUNT];
+    uint64_t t0 = time_us_64();   // echo polling + gaps are wait time (see diag.c)
     for (int i=0;i<SAMPLE_COUNT;i++){
-        uint32_t us = pulse_us();
-        v[i] = us ? (us/58) : 0;
+        v[i] = pulse_us();
         sleep_ms(8);
     }
     uint32_t m = median5(v);
     if (m == 0) {                  // retry once if timeout/no echo
-        uint32_t us2 = pulse_us();
-        m = us2 ? (us2/58) : 0;
+        m = pulse_us();
     }
+    diag_add_idle_us((uint32_t)(time_us_64() - t0));
+    last_echo_us = m;
     return m;
 }
 
+uint32_t ultra_read_cm(void) {
+    return read_median_us() / 58;
+}
+
+uint32_t ultra_read_mm(void) {
+    return (read_median_us() * 10) / 58;
+}
+
+uint32_t ultra_last_cm(void) {
+    return last_echo_us / 58;
+}
+
 void ultra_apply_direct(DriveCmd cmd) {
-    switch (cmd) {
-        case CMD_FORWARD:       motor_forward(); break;
-        case CMD_BACKWARD:      motor_backward(); break;
-        case CMD_LEFT:          motor_left(); break;
-        case CMD_RIGHT:         motor_right(); break;
-        case CMD_FWD_LEFT:      motor_forward_left(); break;
-        case CMD_FWD_RIGHT:     motor_forward_right(); break;
-        case CMD_BWD_LEFT:      motor_backward_left(); break;
-        case CMD_BWD_RIGHT:     motor_backward_right(); break;
-        case CMD_STOP:
-        default:                motor_stop(); break;
-    }
+    motor_apply(cmd);
 }
 
 /* ---------------- Side-step-until-clear FSM ---------------- */
@@ -92,7 +99,8 @@ typedef enum {
     AV_TURN_BACK_90,
     AV_PAUSE_CHECK,
     AV_DECIDE,
-    AV_GO_FORWARD
+    AV_GO_FORWARD,
+    AV_BACK_OFF          // stall recovery: reversing before the side-step
 } AvState;
 
 typedef enum { SIDE_LEFT=0, SIDE_RIGHT=1 } Side;
@@ -102,13 +110,23 @@ typedef struct {
     AvState st;
     Side side;
     uint8_t side_steps;
+    uint16_t backoff_ms;
     absolute_time_t until;
 } Avoidor;
 
 static Avoidor A = {0};
 
 static inline void set_until_ms(int ms){ A.until = delayed_by_ms(get_absolute_time(), ms); }
-static inline bool due(void){ return absolute_time_diff_us(get_absolute_time(), A.until) <= 0; }
+
+/* A segment is over once its time is up AND the wheels have ramped back to
+ * zero, so every manoeuvre runs stop -> move -> stop: the shape calib.c
+ * times the pivots with. Chained straight into the next command, the
+ * profile's ramps would carry each pivot on into the following drive. */
+static inline bool due(void){
+    if (absolute_time_diff_us(get_absolute_time(), A.until) > 0) return false;
+    motor_stop();
+    return !profile_busy();
+}
 
 /* degree-based timed motor helpers using per-side calibration */
 static inline void turn_left_deg(int deg){  motor_left();  set_until_ms(ms_for_deg_left(deg)); }
@@ -116,12 +134,15 @@ static inline void turn_right_deg(int deg){ motor_right(); set_until_ms(ms_for_d
 
 static inline void do_left_90(void){  turn_left_deg(90); }
 static inline void do_right_90(void){ turn_right_deg(90); }
-static inline void do_drive_side(void){ motor_forward(); set_until_ms(DRIVE_MS); }
+static inline void do_drive_side(void){ motor_forward(); set_until_ms(params_get()->drive_ms); }
 static inline void do_turnback_90(Side s){
-    /* Add a small bias so we finish truly facing forward again */
-    int back_deg = 90 + TURNBACK_BIAS_DEG;
-    if (s==SIDE_LEFT)  turn_right_deg(back_deg);
-    else               turn_left_deg(back_deg);
+    /* A measured bias is the drift over one side-step, + = to the left: a
+     * left step turns back further to undo it, a right step turns back less.
+     * The hand-tuned default just adds to both, as it always has. */
+    const RoverParams *p = params_get();
+    int bias = p->turnback_bias_deg;
+    if (s==SIDE_LEFT)  turn_right_deg(90 + bias);
+    else               turn_left_deg(90 + (p->bias_measured ? -bias : bias));
 }
 static inline void do_pause_check(void){ motor_stop(); set_until_ms(CHECK_PAUSE_MS); }
 static inline void do_forward_clear(void){ motor_forward(); set_until_ms(FORWARD_CLEAR_MS); }
@@ -138,6 +159,13 @@ static inline void start_avoid(Side first){
 /* main FSM step */
 static void avoidor_tick(void){
     switch (A.st){
+    case AV_BACK_OFF:
+        if (!due()) break;
+        motor_backward();
+        set_until_ms(A.backoff_ms);
+        A.st = AV_TURN_90;
+        break;
+
     case AV_TURN_90:
         if (!due()) break;
         if (A.side==SIDE_LEFT) do_left_90(); else do_right_90();
@@ -205,18 +233,60 @@ static void avoidor_tick(void){
     }
 }
 
-void ultra_obstacle_aware_apply(DriveCmd desired) {
+/* true if the caller may drive this pass; otherwise avoidance has the motors */
+static bool obstacle_gate(bool wants_forward) {
     uint32_t d = ultra_read_cm();
+    /* the read takes ~50 ms; a stall halt in that time is the main loop's
+     * next pass to handle, not something to drive straight over */
+    if (stall_pending()) return false;
 
     if (A.mode == MODE_MANUAL) {
-        bool wants_forward = (desired == CMD_FORWARD || desired == CMD_FWD_LEFT || desired == CMD_FWD_RIGHT);
         if (wants_forward && (d == 0 || d <= STOP_CM)) {
             printf("Obstacle at %lucm → side-step until clear\n", (unsigned long)d);
             start_avoid(SIDE_LEFT);   // start left; continues sliding on that side
-            return;
+            return false;
         }
-        ultra_apply_direct(desired);
-    } else {
-        avoidor_tick();
+        return true;
     }
+    avoidor_tick();
+    return false;
+}
+
+void ultra_obstacle_aware_apply(DriveCmd desired) {
+    bool wants_forward = (desired == CMD_FORWARD || desired == CMD_FWD_LEFT || desired == CMD_FWD_RIGHT);
+    if (obstacle_gate(wants_forward)) ultra_apply_direct(desired);
+}
+
+void ultra_obstacle_aware_velocity(int16_t left, int16_t right) {
+    bool wants_forward = ((int32_t)left + right) > 0;
+    if (obstacle_gate(wants_forward)) profile_set_target(left, right);
+}
+
+bool ultra_is_avoiding(void) {
+    return A.mode == MODE_AVOID;
+}
+
+void ultra_start_recovery(uint16_t backoff_ms) {
+    start_avoid(SIDE_LEFT);
+    A.backoff_ms = backoff_ms;
+    A.st = AV_BACK_OFF;
+}
+
+void ultra_cancel_avoidance(void) {
+    motor_stop();
+    A.mode = MODE_MANUAL;
+    A.st = AV_IDLE;
+}
+
+int ultra_format_status(char *buf, size_t n) {
+    static const char *NAMES[] = {"idle", "turn", "side", "turnback", "pause", "check", "forward", "backoff"};
+    if (n == 0) return 0;
+    int len;
+    if (A.mode == MODE_AVOID)
+        len = snprintf(buf, n, "A: avoid %s | side=%s | steps=%u\r\n", NAMES[A.st],
+                       A.side == SIDE_LEFT ? "left" : "right", (unsigned)A.side_steps);
+    else
+        len = snprintf(buf, n, "A: manual\r\n");
+    if (len < 0) return 0;
+    return (len < (int)n) ? len : (int)n - 1;
 }
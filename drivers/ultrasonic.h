@@ -3,37 +3,50 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "motor.h"      // DriveCmd
 
 // ===== Configure your sensor pins here =====
 #define ULTRA_TRIG_PIN 2
 #define ULTRA_ECHO_PIN 3
 
-// ===== Drive command type (maps to your motor.h functions) =====
-typedef enum {
-    CMD_STOP = 0,
-    CMD_FORWARD,
-    CMD_BACKWARD,
-    CMD_LEFT,
-    CMD_RIGHT,
-    CMD_FWD_LEFT,
-    CMD_FWD_RIGHT,
-    CMD_BWD_LEFT,
-    CMD_BWD_RIGHT
-} DriveCmd;
-
 // Initialize GPIO for ultrasonic
 void ultra_init(void);
 
 // Read distance (cm); 0 means invalid/timeout
 uint32_t ultra_read_cm(void);
 
+// Same reading in mm (finer than the cm value, used by calibration)
+uint32_t ultra_read_mm(void);
+
+// Most recent reading taken by anyone (cm, 0 = no echo); does not trigger.
+uint32_t ultra_last_cm(void);
+
 // Call this every loop with your *desired* command.
 // If path is clear, it forwards to motor_*().
 // If blocked (within STOP_CM) *and* you're trying to go forward,
 // it runs avoidance then hands control back automatically.
 void ultra_obstacle_aware_apply(DriveCmd desired);
 
-// (Optional) Quick manual passthrough if you don’t need avoidance:
+// Same gate for analog per-wheel velocities (Q15, see PROFILE_VMAX);
+// anything with a net forward component counts as "going forward".
+void ultra_obstacle_aware_velocity(int16_t left, int16_t right);
+
+// (Optional) Quick manual passthrough if you don’t need avoidance
+// (same as motor_apply()):
 void ultra_apply_direct(DriveCmd cmd);
 
+// True while the side-step FSM owns the motors (desired cmd is ignored).
+bool ultra_is_avoiding(void);
+
+// Stall recovery (stall.c): reverse for backoff_ms, then run the same
+// side-step-until-clear sequence as for an obstacle. Main loop only.
+void ultra_start_recovery(uint16_t backoff_ms);
+
+// Drop out of avoidance/recovery and stop. Main loop only.
+void ultra_cancel_avoidance(void);
+
+// One "A: ..." telemetry line with the avoidance state. Returns chars written.
+int ultra_format_status(char *buf, size_t n);
+
 #endif // ULTRASONIC_H
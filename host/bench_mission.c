@@ -0,0 +1,321 @@
+// Path tracking and airtime: onboard mission (mission.c) vs streamed teleop.
+//
+// Both runs drive the same rectangle on the same plant: the real motor.c,
+// profile.c and mission.c, with each wheel a first-order lag behind the PWM
+// it is given (deadband, per-wheel gain error). The teleop run is what a PC
+// would do without missions: follow the same waypoints from odometry it
+// receives over telemetry, sending a command every TELEOP_MS, both ways
+// through a link with latency, jitter and loss.
+//
+// Reported per run: cross-track error of the true pose against the ideal
+// path, where the rover ended up, time taken, and datagrams / bytes sent.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "host_sdk.h"
+#include "hardware/pwm.h"
+#include "motor.h"
+#include "profile.h"
+#include "encoder.h"
+#include "params.h"
+#include "mission.h"
+
+#define PATH_TEXT   "w 600 0; w 600 400; w 0 400; w 0 0"
+#define LOOP_MS     25      // main-loop pass (ultrasonic read dominates)
+#define TELEOP_MS   100     // operator command rate
+#define ODOM_MS     100     // odometry stream the operator steers by
+#define LAT_MIN_MS  10      // one-way link latency...
+#define LAT_MAX_MS  60
+#define LOSS        0.02    // ...and datagram loss
+#define UDP_IP_HDR  28
+#define TIME_LIMIT_MS 180000
+#define RUNS        20
+
+static const float PATH[][2] = {{0, 0}, {600, 0}, {600, 400}, {0, 400}, {0, 0}};
+#define PATH_N (int)(sizeof PATH / sizeof PATH[0])
+
+/* ---------------- Plant ---------------- */
+#define SLICE_L      4        // GP8/9, see motor.c
+#define SLICE_R      5
+#define PWM_FULL     6250
+#define DEADBAND     0.15
+#define TAU_S        0.030
+#define COAST_TAU_S  0.080
+
+typedef struct {
+    double x, y, th;         // true pose
+    double v[2];             // wheel surface speed, mm/s
+    double gain[2];
+    double frac[2];          // partial encoder tick
+    uint32_t ticks[2];
+} Plant;
+
+static Plant P;
+
+static double duty_of(uint32_t cc, bool *braking) {
+    int a = (int)(cc & 0xffff), b = (int)(cc >> 16);
+    *braking = a >= PWM_FULL && b >= PWM_FULL;
+    return *braking ? 0.0 : (double)(a - b) / PWM_FULL;
+}
+
+static void plant_step(double dt) {
+    const RoverParams *rp = params_get();
+    const double mm_per_tick = rp->wheel_circum_mm / rp->counts_per_rev;
+    const double vmax = rp->full_speed_tps * mm_per_tick;
+    const uint32_t cc[2] = {pwm_hw->slice[SLICE_L].cc, pwm_hw->slice[SLICE_R].cc};
+
+    for (int i = 0; i < 2; i++) {
+        bool brake;
+        double d = duty_of(cc[i], &brake), m = fabs(d);
+        double target = m < DEADBAND ? 0.0 : copysign((m - DEADBAND) / (1.0 - DEADBAND), d) * vmax * P.gain[i];
+        double tau = (target == 0.0 && !brake) ? COAST_TAU_S : TAU_S;
+        P.v[i] += (target - P.v[i]) * dt / tau;
+
+        P.frac[i] += fabs(P.v[i]) * dt / mm_per_tick;
+        while (P.frac[i] >= 1.0) { P.frac[i] -= 1.0; P.ticks[i]++; }
+    }
+    double ds = 0.5 * (P.v[0] + P.v[1]) * dt;
+    double dth = (P.v[1] - P.v[0]) * dt / rp->track_width_mm;
+    P.x += ds * cos(P.th + 0.5 * dth);
+    P.y += ds * sin(P.th + 0.5 * dth);
+    P.th += dth;
+}
+
+void encoder_get_ticks(uint32_t *l, uint32_t *r) { *l = P.ticks[0]; *r = P.ticks[1]; }
+void encoder_get_last_edge_us(uint32_t *l, uint32_t *r) { *l = *r = 0; }
+float encoder_mm_per_tick(void) { return params_get()->wheel_circum_mm / params_get()->counts_per_rev; }
+bool ultra_is_avoiding(void) { return false; }
+
+/* ---------------- Metrics ---------------- */
+typedef struct {
+    double sq_sum, max_xte;
+    long n;
+    double end_err, time_s;
+    long pkts_up, pkts_down, bytes_up, bytes_down;
+    bool done;
+} Result;
+
+static double dist_to_path(double x, double y) {
+    double best = 1e9;
+    for (int i = 0; i + 1 < PATH_N; i++) {
+        double ax = PATH[i][0], ay = PATH[i][1], bx = PATH[i + 1][0], by = PATH[i + 1][1];
+        double dx = bx - ax, dy = by - ay;
+        double t = ((x - ax) * dx + (y - ay) * dy) / (dx * dx + dy * dy);
+        t = t < 0 ? 0 : t > 1 ? 1 : t;
+        double d = hypot(x - ax - t * dx, y - ay - t * dy);
+        if (d < best) best = d;
+    }
+    return best;
+}
+
+static void sample(Result *r) {
+    double d = dist_to_path(P.x, P.y);
+    r->sq_sum += d * d;
+    if (d > r->max_xte) r->max_xte = d;
+    r->n++;
+}
+
+static void run_loop_pass(Result *r) {
+    for (int k = 0; k < LOOP_MS; k++) {
+        host_run_ms(1);
+        plant_step(0.001);
+    }
+    sample(r);
+}
+
+static void reset_plant(void) {
+    motor_halt(MOTOR_COAST);
+    host_run_ms(10);
+    memset(&P, 0, sizeof P);
+    P.gain[0] = 0.96 + 0.02 * host_rand();   // wheels never quite match
+    P.gain[1] = 1.02 + 0.02 * host_rand();
+}
+
+/* ---------------- Onboard mission ---------------- */
+static Result run_mission(void) {
+    Result r = {0};
+    reset_plant();
+    mission_load(PATH_TEXT, false);
+    r.pkts_up = 1;
+    r.bytes_up = UDP_IP_HDR + (long)strlen("mission " PATH_TEXT);
+
+    uint32_t t0 = to_ms_since_boot(get_absolute_time());
+    while (to_ms_since_boot(get_absolute_time()) - t0 < TIME_LIMIT_MS) {
+        DriveCmd cmd = CMD_STOP;
+        bool running = mission_tick(&cmd);
+        motor_apply(cmd);
+        if (!running) { r.done = true; break; }
+        run_loop_pass(&r);
+    }
+    r.time_s = (to_ms_since_boot(get_absolute_time()) - t0) / 1000.0;
+    host_run_ms(300);   // let it roll to a stop
+    plant_step(0.0);
+    r.end_err = hypot(P.x - PATH[PATH_N - 1][0], P.y - PATH[PATH_N - 1][1]);
+    return r;
+}
+
+/* ---------------- Streamed teleop ----------------
+ * The operator's side: the same follower as mission.c, on odometry that
+ * arrives over the link. Odometry is integrated rover-side from ticks and
+ * motor_get_dir() exactly as mission.c does and sampled every ODOM_MS.
+ * The angle thresholds are wider than mission.c's: with ~100 ms between
+ * looks at the pose, those hunt and the run takes twice as long. */
+#define WP_TOL_MM       40.0
+#define PIVOT_ENTER_DEG 35.0
+#define PIVOT_EXIT_DEG  15.0
+#define ARC_DEG         10.0
+#define MAX_INFLIGHT    64
+
+typedef struct { uint32_t at_ms; double x, y, th; DriveCmd cmd; } Packet;
+
+typedef struct {
+    Packet q[MAX_INFLIGHT];
+    int n;
+} Link;
+
+static bool link_send(Link *l, Packet p, uint32_t now) {
+    if (host_rand() < LOSS || l->n == MAX_INFLIGHT) return false;
+    p.at_ms = now + LAT_MIN_MS + (uint32_t)(host_rand() * (LAT_MAX_MS - LAT_MIN_MS));
+    l->q[l->n++] = p;
+    return true;
+}
+
+/* oldest packet that has arrived by now (UDP can reorder; so does this) */
+static bool link_recv(Link *l, uint32_t now, Packet *out) {
+    int best = -1;
+    for (int i = 0; i < l->n; i++)
+        if ((int32_t)(now - l->q[i].at_ms) >= 0 && (best < 0 || l->q[i].at_ms < l->q[best].at_ms)) best = i;
+    if (best < 0) return false;
+    *out = l->q[best];
+    l->q[best] = l->q[--l->n];
+    return true;
+}
+
+static const char *CMD_TEXT[CMD_COUNT] = {
+    "stop", "forward", "backward", "left", "right",
+    "forward_left", "forward_right", "backward_left", "backward_right"
+};
+
+static double wrap_pi(double a) {
+    while (a > M_PI) a -= 2 * M_PI;
+    while (a < -M_PI) a += 2 * M_PI;
+    return a;
+}
+
+static Result run_teleop(void) {
+    Result r = {0};
+    reset_plant();
+
+    double ox = 0, oy = 0, oth = 0;           // rover odometry
+    int8_t sign[2] = {1, 1};
+    uint32_t last[2] = {0, 0};
+    double px = 0, py = 0, pth = 0;           // operator's view of it
+    int wp = 1;
+    bool pivoting = false;
+    DriveCmd rover_cmd = CMD_STOP;
+    Link up = {0}, down = {0};
+
+    uint32_t t0 = to_ms_since_boot(get_absolute_time());
+    uint32_t next_cmd = t0, next_odom = t0;
+    char text[256];
+
+    while (to_ms_since_boot(get_absolute_time()) - t0 < TIME_LIMIT_MS) {
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+
+        /* rover: odometry, telemetry out, latest command in */
+        int8_t dl, dr;
+        motor_get_dir(&dl, &dr);
+        if (dl) sign[0] = dl;
+        if (dr) sign[1] = dr;
+        const double k = encoder_mm_per_tick();
+        double sl = (P.ticks[0] - last[0]) * k * sign[0], sr = (P.ticks[1] - last[1]) * k * sign[1];
+        last[0] = P.ticks[0]; last[1] = P.ticks[1];
+        double dth = (sr - sl) / params_get()->track_width_mm;
+        ox += 0.5 * (sl + sr) * cos(oth + 0.5 * dth);
+        oy += 0.5 * (sl + sr) * sin(oth + 0.5 * dth);
+        oth = wrap_pi(oth + dth);
+
+        if ((int32_t)(now - next_odom) >= 0) {
+            next_odom += ODOM_MS;
+            int len = snprintf(text, sizeof text,
+                "L: ticks=%-4lu | rpm=%-6.1f | speed=%-5.1f mm/s | total=%.1f mm\r\n"
+                "R: ticks=%-4lu | rpm=%-6.1f | speed=%-5.1f mm/s | total=%.1f mm\r\n---\r\n",
+                18ul, 135.0, 132.6, P.ticks[0] * k, 18ul, 135.0, 132.6, P.ticks[1] * k);
+            r.pkts_down++;
+            r.bytes_down += UDP_IP_HDR + len;
+            link_send(&down, (Packet){0, ox, oy, oth, CMD_STOP}, now);
+        }
+        Packet pk;
+        while (link_recv(&up, now, &pk)) rover_cmd = pk.cmd;
+        motor_apply(rover_cmd);
+
+        /* operator */
+        while (link_recv(&down, now, &pk)) { px = pk.x; py = pk.y; pth = pk.th; }
+        if ((int32_t)(now - next_cmd) >= 0) {
+            next_cmd += TELEOP_MS;
+            DriveCmd c = CMD_STOP;
+            while (wp < PATH_N && hypot(PATH[wp][0] - px, PATH[wp][1] - py) < WP_TOL_MM) {
+                wp++;
+                pivoting = false;
+            }
+            if (wp < PATH_N) {
+                double err = wrap_pi(atan2(PATH[wp][1] - py, PATH[wp][0] - px) - pth) * 180.0 / M_PI;
+                if (fabs(err) > PIVOT_ENTER_DEG) pivoting = true;
+                else if (fabs(err) < PIVOT_EXIT_DEG) pivoting = false;
+                if (pivoting)                c = err > 0 ? CMD_LEFT : CMD_RIGHT;
+                else if (fabs(err) > ARC_DEG) c = err > 0 ? CMD_FWD_LEFT : CMD_FWD_RIGHT;
+                else                         c = CMD_FORWARD;
+            }
+            r.pkts_up++;
+            r.bytes_up += UDP_IP_HDR + (long)strlen(CMD_TEXT[c]);
+            link_send(&up, (Packet){0, 0, 0, 0, c}, now);
+            if (wp >= PATH_N && rover_cmd == CMD_STOP) { r.done = true; break; }
+        }
+        run_loop_pass(&r);
+    }
+    r.time_s = (to_ms_since_boot(get_absolute_time()) - t0) / 1000.0;
+    motor_apply(CMD_STOP);
+    host_run_ms(300);
+    r.end_err = hypot(P.x - PATH[PATH_N - 1][0], P.y - PATH[PATH_N - 1][1]);
+    return r;
+}
+
+/* ---------------- Report ---------------- */
+static void report(const char *name, const Result *rs, int n) {
+    double rms = 0, max = 0, end = 0, t = 0, pu = 0, pd = 0, bu = 0, bd = 0;
+    int done = 0;
+    for (int i = 0; i < n; i++) {
+        rms += sqrt(rs[i].sq_sum / rs[i].n);
+        if (rs[i].max_xte > max) max = rs[i].max_xte;
+        end += rs[i].end_err;
+        t += rs[i].time_s;
+        pu += rs[i].pkts_up; pd += rs[i].pkts_down;
+        bu += rs[i].bytes_up; bd += rs[i].bytes_down;
+        done += rs[i].done;
+    }
+    printf("%-8s | %6.1f | %6.1f | %6.1f | %5.1f | %4d/%-3d | %6.0f / %-6.0f | %7.0f / %-7.0f\n",
+           name, rms / n, max, end / n, t / n, done, n, pu / n, pd / n, bu / n, bd / n);
+}
+
+int main(void) {
+    RoverParams rp;
+    params_defaults(&rp);
+    params_set(&rp);
+    motor_init_pins();
+    profile_init();
+    host_srand(26);
+
+    static Result mission[RUNS], teleop[RUNS];
+    for (int i = 0; i < RUNS; i++) {
+        mission[i] = run_mission();
+        teleop[i] = run_teleop();
+    }
+
+    printf("600 x 400 mm rectangle, %d runs; teleop at %d ms, link %d-%d ms one way, %.0f%% loss\n",
+           RUNS, TELEOP_MS, LAT_MIN_MS, LAT_MAX_MS, LOSS * 100);
+    printf("mode     | xte mm | max mm | end mm | t s   | done     | pkts up / down  | bytes up / down\n");
+    report("mission", mission, RUNS);
+    report("teleop", teleop, RUNS);
+    return 0;
+}
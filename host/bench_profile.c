@@ -0,0 +1,308 @@
+// Motion profile (profile.c) against the old bang-bang switching.
+//
+// Each wheel is a DC motor on a gearbox with half the rover's mass on a
+// contact patch that holds at most TRACTION_N. Duty comes from the real
+// motor.c / profile.c CC writes for the profile, or straight from the
+// command table (full duty at once) for bang-bang.
+//
+// Part 1, per transition: wheel slip (mm of tyre sliding over the floor),
+// settle time (to within 5% of the final speed) and peak winding current,
+// the proxy for brown-outs and gearbox shock.
+//
+// Part 2, the avoidance side-step: turn out, drive, turn back, with pivot
+// times calibrated the way calib.c does it (stop -> pivot -> stop). The
+// profile with segments chained straight into each other is what the FSM
+// did before its segments waited for the ramp; stop-separated is what it
+// does now.
+//
+// Part 3, retargets that land mid-ramp: a stop while still speeding up,
+// mission arcs switching forward / fwd_left every pass, and a "vel" stick
+// sweep. Peak output acceleration and jerk (VMAX/s, VMAX/s^2) against a
+// ramp from a standstill; a new ramp starting from zero slope would show
+// as a jerk spike of (accel / one tick).
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "host_sdk.h"
+#include "hardware/pwm.h"
+#include "motor.h"
+#include "profile.h"
+#include "params.h"
+
+/* ---------------- Plant (per wheel) ---------------- */
+#define VBAT        6.0      // V
+#define R_OHM       4.0      // winding, ~1.5 A stall
+#define KE          0.286    // V s/rad at the wheel, ~200 rpm no-load
+#define J_WHEEL     1.2e-4   // kg m^2, rotor through the gearbox
+#define B_GEAR      0.004    // N m s/rad gearbox drag; coasts down in ~35 ms
+#define M_HALF      0.25     // kg carried by each wheel
+#define TRACTION_N  1.2      // most the tyre can push with
+#define DT          20e-6
+
+#define SLICE_L     4
+#define SLICE_R     5
+#define PWM_FULL    6250
+
+typedef struct {
+    double w;                // wheel rad/s
+    double v;                // ground speed under it, m/s
+    double slip_m, peak_a;
+} Wheel;
+
+static double radius_m(void) { return params_get()->wheel_circum_mm / (2.0 * M_PI) / 1000.0; }
+
+/* duty in -1..1; brake = both inputs high */
+static void wheel_step(Wheel *wh, double duty, bool brake) {
+    const double r = radius_m();
+    double i = (duty == 0.0 && !brake) ? 0.0 : (duty * VBAT - KE * wh->w) / R_OHM;
+    double tq = KE * i - B_GEAR * wh->w;
+    if (fabs(i) > wh->peak_a) wh->peak_a = fabs(i);
+
+    double slip = wh->w * r - wh->v;
+    double f;
+    if (fabs(slip) < 1e-4) {
+        /* rolling: what force would keep it that way? */
+        double a = (tq / r) / (J_WHEEL / (r * r) + M_HALF);
+        f = M_HALF * a;
+        if (fabs(f) > TRACTION_N) f = copysign(TRACTION_N, f);
+    } else {
+        f = copysign(TRACTION_N, slip);
+    }
+    double w1 = wh->w + (tq - f * r) / J_WHEEL * DT;
+    double v1 = wh->v + f / M_HALF * DT;
+    /* sliding stops when the speeds cross */
+    if (fabs(slip) >= 1e-4 && (w1 * r - v1) * slip <= 0.0) w1 = v1 / r;
+    wh->w = w1;
+    wh->v = v1;
+    wh->slip_m += fabs(wh->w * r - wh->v) * DT;
+}
+
+static double duty_of(uint32_t cc, bool *brake) {
+    int a = (int)(cc & 0xffff), b = (int)(cc >> 16);
+    *brake = a >= PWM_FULL && b >= PWM_FULL;
+    return *brake ? 0.0 : (double)(a - b) / PWM_FULL;
+}
+
+/* ---------------- Drive sources ---------------- */
+typedef enum { SRC_PROFILE, SRC_BANG } Source;
+
+static const int8_t TABLE[CMD_COUNT][2] = {   // as motor.c
+    {0, 0}, {1, 1}, {-1, -1}, {-1, 1}, {1, -1}, {0, 1}, {1, 0}, {0, -1}, {-1, 0}
+};
+
+static Source src;
+static DriveCmd bang_cmd;
+static Wheel W[2];
+
+static void command(DriveCmd c) {
+    if (src == SRC_PROFILE) motor_apply(c);
+    else bang_cmd = c;
+}
+
+static void step(void) {
+    host_run_us((uint64_t)(DT * 1e6));
+    for (int k = 0; k < 2; k++) {
+        bool brake = false;
+        double d = (src == SRC_PROFILE)
+            ? duty_of(pwm_hw->slice[k ? SLICE_R : SLICE_L].cc, &brake)
+            : TABLE[bang_cmd][k];
+        wheel_step(&W[k], d, brake);
+    }
+}
+
+static void run_ms(double ms) {
+    for (long n = lround(ms / 1000.0 / DT); n > 0; n--) step();
+}
+
+static void reset(Source s, DriveCmd start) {
+    src = s;
+    bang_cmd = start;
+    motor_halt(MOTOR_COAST);
+    motor_apply(start);
+    memset(W, 0, sizeof W);
+    host_run_ms(2 * PROFILE_RAMP_MS + 10);  // profile already at speed
+    double v0 = TABLE[start][0] * VBAT / KE * radius_m();
+    for (int k = 0; k < 2; k++) {
+        W[k].v = TABLE[start][k] * fabs(v0);
+        W[k].w = W[k].v / radius_m();
+    }
+    run_ms(300);                            // and the wheels settled there
+    for (int k = 0; k < 2; k++) W[k].slip_m = W[k].peak_a = 0;
+}
+
+/* ---------------- Part 1: transitions ---------------- */
+#define SETTLE_TOL  0.05
+#define WINDOW_MS   800.0
+
+static void transition(const char *name, DriveCmd from, DriveCmd to) {
+    for (int s = 0; s < 2; s++) {
+        reset((Source)s, from);
+        command(to);
+
+        /* last time either wheel was outside the band around its end speed */
+        const int n = (int)(WINDOW_MS / 1000.0 / DT);
+        static double v[2][40001];
+        for (int i = 0; i < n; i++) {
+            step();
+            v[0][i] = W[0].v;
+            v[1][i] = W[1].v;
+        }
+        double band = SETTLE_TOL * VBAT / KE * radius_m();
+        int last = 0;
+        for (int k = 0; k < 2; k++)
+            for (int i = 0; i < n; i++)
+                if (fabs(v[k][i] - v[k][n - 1]) > band) last = i;
+
+        double slip = (W[0].slip_m + W[1].slip_m) * 1000.0;
+        double peak = fmax(W[0].peak_a, W[1].peak_a);
+        printf("%-16s %-8s | %7.1f | %8.0f | %7.2f\n", name, s == SRC_PROFILE ? "profile" : "bang",
+               slip, (last + 1) * DT * 1000.0, peak);
+    }
+}
+
+/* ---------------- Part 2: side-step heading ---------------- */
+static double heading_deg;
+
+static void run_track_ms(double ms) {
+    const double track = params_get()->track_width_mm / 1000.0;
+    for (long n = lround(ms / 1000.0 / DT); n > 0; n--) {
+        step();
+        heading_deg += (W[1].v - W[0].v) / track * DT * 180.0 / M_PI;
+    }
+}
+
+/* pivot for ms from a standstill and let it stop: calib.c's measurement */
+static double pivot_deg(Source s, double ms) {
+    reset(s, CMD_STOP);
+    heading_deg = 0;
+    command(CMD_LEFT);
+    run_track_ms(ms);
+    command(CMD_STOP);
+    run_track_ms(600);
+    return heading_deg;
+}
+
+/* two test pivots and an affine fit, as calib_est.c does */
+static double calibrate_90(Source s) {
+    double m0 = 250, m1 = 375, k0 = pivot_deg(s, m0), k1 = pivot_deg(s, m1);
+    return m0 + (90.0 - k0) * (m1 - m0) / (k1 - k0);
+}
+
+/* turn out left, drive, turn back right; returns the heading the drive ran
+ * on (what the turn-out came to) and how far the turn-back undid it */
+static void side_step(Source s, bool chained, double t90, double *out, double *back) {
+    const double drive_ms = params_get()->drive_ms;
+    reset(s, CMD_FORWARD);
+    heading_deg = 0;
+    if (!chained) { command(CMD_STOP); run_track_ms(2 * PROFILE_RAMP_MS); }
+
+    const DriveCmd seg[3] = {CMD_LEFT, CMD_FORWARD, CMD_RIGHT};
+    const double ms[3] = {t90, drive_ms, t90};
+    for (int i = 0; i < 3; i++) {
+        command(seg[i]);
+        run_track_ms(ms[i]);
+        if (!chained) { command(CMD_STOP); run_track_ms(2 * PROFILE_RAMP_MS); }
+        if (i == 1) *out = heading_deg;
+    }
+    command(CMD_STOP);
+    run_track_ms(600);
+    *back = *out - heading_deg;
+}
+
+/* ---------------- Part 3: mid-ramp retargets ---------------- */
+typedef struct { double acc, jerk; int16_t prev[2]; double rate[2]; int n; } Shape;
+
+/* one profile tick: plant steps plus the output's rate of change */
+static void shape_tick(Shape *sh) {
+    const double tick_s = PROFILE_TICK_MS / 1000.0;
+    run_ms(PROFILE_TICK_MS);
+    int16_t out[2];
+    profile_get_output(&out[0], &out[1]);
+    for (int k = 0; k < 2; k++) {
+        double rate = (double)(out[k] - sh->prev[k]) / PROFILE_VMAX / tick_s;
+        if (sh->n > 0) {
+            sh->acc = fmax(sh->acc, fabs(rate));
+            if (sh->n > 1) sh->jerk = fmax(sh->jerk, fabs(rate - sh->rate[k]) / tick_s);
+        }
+        sh->rate[k] = rate;
+        sh->prev[k] = out[k];
+    }
+    sh->n++;
+}
+
+static void shape_start(Shape *sh, DriveCmd from) {
+    reset(SRC_PROFILE, from);
+    memset(sh, 0, sizeof *sh);
+    profile_get_output(&sh->prev[0], &sh->prev[1]);
+}
+
+static void shape_report(const char *name, const Shape *sh) {
+    printf("%-22s | %7.1f | %9.0f | %7.1f | %6.2f\n", name, sh->acc, sh->jerk,
+           (W[0].slip_m + W[1].slip_m) * 1000.0, fmax(W[0].peak_a, W[1].peak_a));
+}
+
+static void mid_ramp(void) {
+    Shape sh;
+    printf("\nretarget               | accel/s | jerk/s^2 | slip mm | peak A\n");
+
+    shape_start(&sh, CMD_STOP);
+    motor_apply(CMD_FORWARD);
+    for (int t = 0; t < 400; t += PROFILE_TICK_MS) shape_tick(&sh);
+    shape_report("stop->forward (ref)", &sh);
+
+    shape_start(&sh, CMD_STOP);
+    motor_apply(CMD_FORWARD);
+    for (int t = 0; t < 400; t += PROFILE_TICK_MS) {
+        if (t == PROFILE_RAMP_MS / 2) motor_apply(CMD_STOP);   // at peak acceleration
+        shape_tick(&sh);
+    }
+    shape_report("forward, stop mid-ramp", &sh);
+
+    shape_start(&sh, CMD_FORWARD);
+    for (int t = 0; t < 1000; t += PROFILE_TICK_MS) {
+        if (t % 50 == 0) motor_apply((t / 50) % 2 ? CMD_FWD_LEFT : CMD_FORWARD);
+        shape_tick(&sh);
+    }
+    shape_report("arc, 50 ms switching", &sh);
+
+    shape_start(&sh, CMD_STOP);
+    for (int t = 0; t < 2000; t += PROFILE_TICK_MS) {
+        if (t % 20 == 0) {
+            int16_t v = (int16_t)lround(PROFILE_VMAX * sin(2.0 * M_PI * t / 1000.0));
+            profile_set_target(v, v);
+        }
+        shape_tick(&sh);
+    }
+    shape_report("vel sweep, 20 ms steps", &sh);
+}
+
+int main(void) {
+    RoverParams rp;
+    params_defaults(&rp);
+    params_set(&rp);
+    motor_init_pins();
+    profile_init();
+
+    printf("transition       drive    | slip mm | settle ms | peak A\n");
+    transition("stop->forward", CMD_STOP, CMD_FORWARD);
+    transition("forward->stop", CMD_FORWARD, CMD_STOP);
+    transition("forward->back", CMD_FORWARD, CMD_BACKWARD);
+    transition("left->right", CMD_LEFT, CMD_RIGHT);
+    transition("forward->left", CMD_FORWARD, CMD_LEFT);
+
+    const double t_prof = calibrate_90(SRC_PROFILE), t_bang = calibrate_90(SRC_BANG);
+    double out, back;
+    printf("\nside-step, pivots calibrated stop->pivot->stop (%.0f ms profile, %.0f ms bang)\n",
+           t_prof, t_bang);
+    printf("drive                 | turn-out deg | turn-back deg\n");
+    side_step(SRC_BANG, true, t_bang, &out, &back);
+    printf("bang                  | %12.1f | %13.1f\n", out, back);
+    side_step(SRC_PROFILE, true, t_prof, &out, &back);
+    printf("profile, chained      | %12.1f | %13.1f\n", out, back);
+    side_step(SRC_PROFILE, false, t_prof, &out, &back);
+    printf("profile, stop between | %12.1f | %13.1f\n", out, back);
+
+    mid_ramp();
+    return 0;
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Host tests and simulation benchmarks. Builds the real driver sources
+# against the stand-in SDK in sdk/, no Pico toolchain needed.
+#   ./run.sh            everything
+#   ./run.sh bench_mission
+set -e
+cd "$(dirname "$0")"
+CC=${CC:-cc}
+CFLAGS="-std=gnu11 -O2 -Wall -Wextra -Wno-unused-parameter -Isdk -I../drivers"
+D=../drivers
+mkdir -p out
+
+build() {
+    name=$1; shift
+    $CC $CFLAGS -o "out/$name" "$name.c" "$@" sdk/host_sdk.c -lm
+}
+
+run() {
+    case "$ONLY" in ""|"$1") ;; *) return 0 ;; esac
+    echo "== $1"
+    build "$@"
+    "./out/$1"
+}
+
+ONLY=$1
+run test_motor $D/motor.c $D/profile.c
+run test_calib_est $D/calib_est.c $D/params.c
+run test_params $D/params.c
+run test_telemetry $D/telemetry.c $D/params.c
+run test_mission $D/mission.c $D/motor.c $D/profile.c $D/params.c
+run bench_mission $D/mission.c $D/motor.c $D/profile.c $D/params.c
+run bench_profile $D/motor.c $D/profile.c $D/params.c
+run sim_stall $D/stall.c $D/motor.c $D/profile.c $D/params.c
@@ -0,0 +1,18 @@
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Flash is a RAM array on the host; XIP reads see what was programmed.
+#define FLASH_SECTOR_SIZE     4096u
+#define FLASH_PAGE_SIZE       256u
+#define PICO_FLASH_SIZE_BYTES (2u * 1024 * 1024)
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)host_flash)
+
+void flash_range_erase(uint32_t offset, size_t count);
+void flash_range_program(uint32_t offset, const uint8_t *data, size_t count);
+
+#endif // HOST_HARDWARE_FLASH_H
@@ -0,0 +1,17 @@
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+enum { GPIO_IN = 0, GPIO_OUT = 1 };
+enum gpio_function { GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5 };
+
+static inline void gpio_init(uint gpio) { (void)gpio; }
+static inline void gpio_set_dir(uint gpio, bool out) { (void)gpio; (void)out; }
+static inline void gpio_put(uint gpio, bool value) { (void)gpio; (void)value; }
+static inline void gpio_set_function(uint gpio, enum gpio_function fn) { (void)gpio; (void)fn; }
+
+#endif // HOST_HARDWARE_GPIO_H
@@ -0,0 +1,37 @@
+#ifndef HOST_HARDWARE_PWM_H
+#define HOST_HARDWARE_PWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+// Register block as on the RP2040: cc is B << 16 | A. The counter and the
+// CC latch are modelled (see host_sdk.h) for code that goes through
+// pwm_get_counter() / pwm_set_both_levels(); cc here is what was last
+// written, ctr what the last pwm_get_counter() saw.
+typedef struct {
+    volatile uint32_t csr, div, ctr, cc, top;
+} pwm_slice_hw_t;
+
+typedef struct {
+    pwm_slice_hw_t slice[8];
+    volatile uint32_t en;
+} pwm_hw_t;
+
+extern pwm_hw_t *pwm_hw;
+
+typedef struct {
+    uint32_t csr, div, top;
+} pwm_config;
+
+static inline uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1u) & 7u; }
+static inline pwm_config pwm_get_default_config(void) { return (pwm_config){0, 1u << 4, 0xffff}; }
+static inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) { c->top = wrap; }
+
+void pwm_init(uint slice, pwm_config *c, bool start);
+void pwm_set_both_levels(uint slice, uint16_t a, uint16_t b);
+uint16_t pwm_get_counter(uint slice);
+void pwm_set_mask_enabled(uint32_t mask);
+
+#endif // HOST_HARDWARE_PWM_H
@@ -0,0 +1,206 @@
+#include "host_sdk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "hardware/pwm.h"
+
+/* ---------------- Time and timers ---------------- */
+#define MAX_TIMERS 8
+
+typedef struct {
+    repeating_timer_t *t;
+    repeating_timer_callback_t cb;
+    uint64_t period_us;
+    uint64_t next_us;
+} Timer;
+
+static Timer timers[MAX_TIMERS];
+static int n_timers = 0;
+static uint64_t now_us = 0;
+
+absolute_time_t get_absolute_time(void) { return now_us; }
+absolute_time_t make_timeout_time_ms(uint32_t ms) { return now_us + (uint64_t)ms * 1000u; }
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + (uint64_t)ms * 1000u; }
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return (int64_t)(to - from); }
+uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000u); }
+uint64_t time_us_64(void) { return now_us; }
+uint32_t time_us_32(void) { return (uint32_t)now_us; }
+void sleep_ms(uint32_t ms) { host_run_ms(ms); }
+void sleep_us(uint64_t us) { host_run_us(us); }
+
+/* negative ms (start-to-start on the Pico) and positive are the same here:
+ * callbacks take no simulated time */
+bool add_repeating_timer_ms(int32_t ms, repeating_timer_callback_t cb, void *user_data, repeating_timer_t *out) {
+    if (n_timers == MAX_TIMERS || ms == 0) return false;
+    uint64_t period = (uint64_t)(ms < 0 ? -ms : ms) * 1000u;
+    out->delay_us = ms * 1000;
+    out->user_data = user_data;
+    timers[n_timers++] = (Timer){out, cb, period, now_us + period};
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *t) {
+    for (int i = 0; i < n_timers; i++) {
+        if (timers[i].t != t) continue;
+        timers[i] = timers[--n_timers];
+        return true;
+    }
+    return false;
+}
+
+void host_run_us(uint64_t us) {
+    const uint64_t end = now_us + us;
+    for (;;) {
+        int due = -1;
+        for (int i = 0; i < n_timers; i++)
+            if (timers[i].next_us <= end && (due < 0 || timers[i].next_us < timers[due].next_us)) due = i;
+        if (due < 0) break;
+
+        Timer *t = &timers[due];
+        now_us = t->next_us;
+        t->next_us += t->period_us;
+        if (!t->cb(t->t)) cancel_repeating_timer(t->t);
+    }
+    now_us = end;
+}
+
+/* xorshift64* */
+static uint64_t rng = 0x9E3779B97F4A7C15ull;
+
+void host_srand(uint64_t seed) { rng = seed ? seed : 0x9E3779B97F4A7C15ull; }
+
+double host_rand(void) {
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return (double)((rng * 0x2545F4914F6CDD1Dull) >> 11) / 9007199254740992.0;
+}
+
+/* ---------------- PWM ---------------- */
+#define COST_COUNTER  6     // load + compare + branch of a polling loop
+#define COST_STORE    2
+
+static pwm_hw_t pwm_regs;
+pwm_hw_t *pwm_hw = &pwm_regs;
+
+static uint64_t cpu_cyc, enable_cyc;   // CPU clock; counters start at enable_cyc
+static uint32_t skew_cyc, store_stall;
+static uint64_t latch_wrap[8];
+
+/* time moves on by cost; never backwards within one simulated instant */
+static uint64_t cpu_advance(uint32_t cost) {
+    uint64_t base = now_us * HOST_CPU_MHZ + skew_cyc;
+    if (cpu_cyc < base) cpu_cyc = base;
+    cpu_cyc += cost;
+    return cpu_cyc;
+}
+
+static uint32_t period(uint slice) { return pwm_hw->slice[slice].top + 1; }
+
+void host_pwm_skew(uint32_t cycles) { skew_cyc = cycles; }
+void host_pwm_stall_next_store(uint32_t cycles) { store_stall = cycles; }
+uint64_t host_pwm_latch_wrap(uint slice) { return latch_wrap[slice]; }
+
+void host_pwm_set_phase(uint slice, uint32_t ctr) {
+    uint64_t c = cpu_advance(0) + COST_COUNTER;   // where the next read lands
+    uint32_t at = (uint32_t)((c - enable_cyc) % period(slice));
+    cpu_cyc += (ctr + period(slice) - at) % period(slice);
+}
+
+uint16_t pwm_get_counter(uint slice) {
+    uint64_t c = cpu_advance(COST_COUNTER);
+    uint16_t v = (uint16_t)((c - enable_cyc) % period(slice));
+    pwm_hw->slice[slice].ctr = v;
+    return v;
+}
+
+void pwm_init(uint slice, pwm_config *c, bool start) {
+    pwm_hw->slice[slice].csr = c->csr | (start ? 1u : 0u);
+    pwm_hw->slice[slice].div = c->div;
+    pwm_hw->slice[slice].top = c->top;
+    pwm_hw->slice[slice].ctr = 0;
+}
+
+void pwm_set_both_levels(uint slice, uint16_t a, uint16_t b) {
+    uint64_t c = cpu_advance(COST_STORE + store_stall);
+    store_stall = 0;
+    pwm_hw->slice[slice].cc = ((uint32_t)b << 16) | a;
+    latch_wrap[slice] = (c - enable_cyc) / period(slice) + 1;
+}
+
+void pwm_set_mask_enabled(uint32_t mask) {
+    pwm_hw->en = mask;
+    enable_cyc = cpu_advance(0);
+}
+
+/* ---------------- Flash ---------------- */
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+void flash_range_erase(uint32_t offset, size_t count) { memset(host_flash + offset, 0xff, count); }
+
+void flash_range_program(uint32_t offset, const uint8_t *data, size_t count) {
+    for (size_t i = 0; i < count; i++) host_flash[offset + i] &= data[i];
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t timeout_ms) {
+    (void)timeout_ms;
+    func(param);
+    return PICO_OK;
+}
+
+/* ---------------- async_context ---------------- */
+static bool worker_fire(repeating_timer_t *rt) {
+    async_at_time_worker_t *w = rt->user_data;
+    w->do_work(NULL, w);
+    return false;
+}
+
+/* a worker that adds itself back from do_work gets a new timer entry after
+ * the one firing, so the false above drops the old one */
+bool async_context_add_at_time_worker_in_ms(async_context_t *ctx, async_at_time_worker_t *w, uint32_t ms) {
+    return add_repeating_timer_ms(ms ? (int32_t)ms : 1, worker_fire, w, &w->timer);
+}
+
+async_context_t *cyw43_arch_async_context(void) { return NULL; }
+
+/* ---------------- lwIP ---------------- */
+HostDatagram host_udp_log[HOST_UDP_LOG];
+int host_udp_sent;
+int host_pbufs_live;
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+    struct pbuf *p = malloc(sizeof *p + length);
+    if (!p) return NULL;
+    *p = (struct pbuf){NULL, p + 1, length, length};
+    host_pbufs_live++;
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+    host_pbufs_live--;
+    free(p);
+    return 1;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst, u16_t port) {
+    if (host_udp_sent < HOST_UDP_LOG) {
+        HostDatagram *d = &host_udp_log[host_udp_sent];
+        size_t n = p->len < sizeof d->text - 1 ? p->len : sizeof d->text - 1;
+        d->addr = dst->addr;
+        d->port = port;
+        d->p = p;
+        memcpy(d->text, p->payload, n);
+        d->text[n] = '\0';
+    }
+    host_udp_sent++;
+    return ERR_OK;
+}
+
+char *ipaddr_ntoa(const ip_addr_t *a) {
+    static char s[16];
+    snprintf(s, sizeof s, "%u.%u.%u.%u", (unsigned)(a->addr & 0xff), (unsigned)(a->addr >> 8 & 0xff),
+             (unsigned)(a->addr >> 16 & 0xff), (unsigned)(a->addr >> 24));
+    return s;
+}
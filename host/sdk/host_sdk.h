@@ -0,0 +1,54 @@
+#ifndef HOST_SDK_H
+#define HOST_SDK_H
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/udp.h"
+
+// Simulation controls for the host stand-in SDK.
+
+// Advance the clock, firing repeating timers in time order as they fall due.
+void host_run_us(uint64_t us);
+static inline void host_run_ms(uint32_t ms) { host_run_us((uint64_t)ms * 1000u); }
+
+// Uniform in [0, 1), own generator so runs repeat across C libraries.
+double host_rand(void);
+void host_srand(uint64_t seed);
+
+// PWM: the counter runs off a 125 MHz CPU clock from pwm_set_mask_enabled()
+// (divider 1), and each pwm_get_counter() / pwm_set_both_levels() takes a
+// few cycles of it. A CC write takes effect at the next counter wrap.
+#define HOST_CPU_MHZ 125
+
+// Shift the CPU clock against simulated time, which moves where in the PWM
+// period timer callbacks land (0 .. TOP).
+void host_pwm_skew(uint32_t cycles);
+
+// Run the CPU clock on until the next register access sees the counter at ctr.
+void host_pwm_set_phase(uint slice, uint32_t ctr);
+
+// Delay the next CC write by this many cycles, as an instruction fetch
+// miss between reading the counter and writing would.
+void host_pwm_stall_next_store(uint32_t cycles);
+
+// Counter wrap (counted from enable) at which the slice's last CC write
+// took effect on its pins.
+uint64_t host_pwm_latch_wrap(uint slice);
+
+// lwIP: udp_sendto() logs each datagram here, up to HOST_UDP_LOG of them;
+// host_udp_sent keeps counting past that. Reset it freely.
+#define HOST_UDP_LOG 256
+typedef struct {
+    u32_t addr;
+    u16_t port;
+    const struct pbuf *p;   // to tell one shared payload from a copy each
+    char text[800];
+} HostDatagram;
+extern HostDatagram host_udp_log[HOST_UDP_LOG];
+extern int host_udp_sent;
+
+// pbufs allocated and not yet freed.
+extern int host_pbufs_live;
+
+#endif // HOST_SDK_H
@@ -0,0 +1,10 @@
+#ifndef HOST_LWIP_ARCH_H
+#define HOST_LWIP_ARCH_H
+
+#include <stdint.h>
+
+typedef uint8_t  u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+#endif // HOST_LWIP_ARCH_H
@@ -0,0 +1,11 @@
+#ifndef HOST_LWIP_ERR_H
+#define HOST_LWIP_ERR_H
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+
+#define ERR_OK    0
+#define ERR_MEM  -1
+
+#endif // HOST_LWIP_ERR_H
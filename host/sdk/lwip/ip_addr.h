@@ -0,0 +1,16 @@
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include "lwip/arch.h"
+
+// IPv4 only, as the Pico W build is configured.
+typedef struct {
+    u32_t addr;
+} ip_addr_t;
+
+#define ip_addr_copy(dest, src) ((dest) = (src))
+#define ip_addr_cmp(a, b)       ((a)->addr == (b)->addr)
+
+char *ipaddr_ntoa(const ip_addr_t *addr);
+
+#endif // HOST_LWIP_IP_ADDR_H
@@ -0,0 +1,15 @@
+#ifndef HOST_LWIP_UDP_H
+#define HOST_LWIP_UDP_H
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+// Nothing goes on the wire: udp_sendto() logs the datagram (see host_sdk.h).
+struct udp_pcb {
+    u16_t local_port;
+};
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port);
+
+#endif // HOST_LWIP_UDP_H
@@ -0,0 +1,21 @@
+#ifndef HOST_PICO_ASYNC_CONTEXT_H
+#define HOST_PICO_ASYNC_CONTEXT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+// At-time workers run off the simulated clock, one-shot as on the Pico:
+// a worker that wants to run again adds itself back.
+typedef struct async_context async_context_t;
+typedef struct async_work_on_timeout async_at_time_worker_t;
+
+struct async_work_on_timeout {
+    void (*do_work)(async_context_t *context, async_at_time_worker_t *worker);
+    void *user_data;
+    repeating_timer_t timer;    // host only
+};
+
+bool async_context_add_at_time_worker_in_ms(async_context_t *context, async_at_time_worker_t *worker, uint32_t ms);
+
+#endif // HOST_PICO_ASYNC_CONTEXT_H
@@ -0,0 +1,8 @@
+#ifndef HOST_PICO_CYW43_ARCH_H
+#define HOST_PICO_CYW43_ARCH_H
+
+#include "pico/async_context.h"
+
+async_context_t *cyw43_arch_async_context(void);
+
+#endif // HOST_PICO_CYW43_ARCH_H
@@ -0,0 +1,46 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+// Host stand-in for the parts of the Pico SDK the drivers use. Time is
+// simulated: it only moves in host_run_us() / sleep_*(), which also fire
+// any repeating timers that fall due (see host_sdk.h).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+absolute_time_t get_absolute_time(void);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+uint32_t to_ms_since_boot(absolute_time_t t);
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+static inline void tight_loop_contents(void) {}
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer {
+    int64_t delay_us;
+    void *user_data;
+};
+bool add_repeating_timer_ms(int32_t ms, repeating_timer_callback_t cb, void *user_data, repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+static inline void stdio_init_all(void) {}
+
+#define PICO_OK 0
+
+// Code placement is the linker's business on the Pico; nothing to do here.
+#define __not_in_flash_func(f) f
+#define __no_inline_not_in_flash_func(f) __attribute__((noinline)) f
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+#endif // HOST_PICO_STDLIB_H
@@ -0,0 +1,256 @@
+// Stall / slip / drag detector (stall.c) against a simulated drivetrain.
+//
+// Each wheel lags its duty (from the real motor.c CC words) by 30 ms, does
+// not turn below 15% duty, runs 15% faster than params says at full duty,
+// and its encoder edges jitter by +-7.5% of a period.
+//
+//   1. 25 min of random driving with no faults: false stalls
+//   2. 200 injected stalls (one wheel stopped dead while driven above 37%):
+//      time from the wheel stopping to the detector seeing it
+//   3. injected slip (wheel lifted, runs 2x) and drag (wheel at 40%):
+//      time until the status line reports it
+//   4. recovery holds: a STOP-mode stall, and a stall while avoiding, keep
+//      stall_service() reporting held until stall_release()
+//
+// Recovery is off for 1-3 so a detection does not stop the drive; the
+// stall count comes from the "S:" status line.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "host_sdk.h"
+#include "hardware/pwm.h"
+#include "motor.h"
+#include "profile.h"
+#include "params.h"
+#include "stall.h"
+#include "encoder.h"
+#include "ultrasonic.h"
+#include "mission.h"
+#include "calib.h"
+
+#define SLICE_L        4
+#define SLICE_R        5
+#define PWM_FULL       6250
+#define DEADBAND       0.15
+#define OVERSPEED      1.15
+#define LAG_S          0.030
+#define EDGE_JITTER    0.15
+#define FP_SECONDS     1500
+#define INJECTIONS     200
+#ifndef SEED
+#define SEED           33        // -DSEED=n for another run
+#endif
+#define DRIVEN_MIN     12000     // |profile output| before a fault is injected
+
+/* ---------------- Plant ---------------- */
+typedef enum { F_NONE, F_STALL, F_SLIP, F_DRAG } Fault;
+
+static double vel[2], phase[2];
+static uint32_t ticks[2], edge_us[2];
+static Fault fault[2];
+
+void encoder_get_ticks(uint32_t *l, uint32_t *r) { *l = ticks[0]; *r = ticks[1]; }
+void encoder_get_last_edge_us(uint32_t *l, uint32_t *r) { *l = edge_us[0]; *r = edge_us[1]; }
+
+static double duty_of(int k) {
+    uint32_t cc = pwm_hw->slice[k ? SLICE_R : SLICE_L].cc;
+    int a = (int)(cc & 0xffff), b = (int)(cc >> 16);
+    if (a >= PWM_FULL && b >= PWM_FULL) return 0.0;   // brake
+    return fabs((double)(a - b)) / PWM_FULL;
+}
+
+static void step_ms(void) {
+    const double dt = 0.001;
+    host_run_ms(1);
+    for (int k = 0; k < 2; k++) {
+        double c = duty_of(k);
+        double target = c < DEADBAND ? 0.0
+                      : (c - DEADBAND) / (1.0 - DEADBAND) * OVERSPEED * params_get()->full_speed_tps;
+        if (fault[k] == F_SLIP) target *= 2.0;
+        if (fault[k] == F_DRAG) target *= 0.4;
+        vel[k] += (target - vel[k]) * dt / LAG_S;
+        if (fault[k] == F_STALL) vel[k] = 0.0;
+        phase[k] += vel[k] * dt * (1.0 + EDGE_JITTER * (host_rand() - 0.5));
+        while (phase[k] >= 1.0) {
+            phase[k] -= 1.0;
+            ticks[k]++;
+            edge_us[k] = time_us_32();
+        }
+    }
+}
+
+/* ---------------- Stand-ins for the rest of the firmware ---------------- */
+static bool avoiding;
+static int cancels, recoveries, mission_aborts;
+bool ultra_is_avoiding(void) { return avoiding; }
+void ultra_start_recovery(uint16_t backoff_ms) { recoveries++; }
+void ultra_cancel_avoidance(void) { cancels++; avoiding = false; }
+void mission_abort(void) { mission_aborts++; }
+void calib_abort(void) {}
+
+/* ---------------- Detector readout ---------------- */
+static char status[160];
+
+static const char *read_status(void) {
+    stall_format_status(status, sizeof status);
+    return status;
+}
+
+static unsigned long stall_count(void) {
+    const char *p = strstr(read_status(), "stalls=");
+    return p ? strtoul(p + 7, NULL, 10) : 0;
+}
+
+static bool reports(int wheel, const char *state) {
+    char want[16];
+    snprintf(want, sizeof want, "%c=%s ", wheel ? 'R' : 'L', state);
+    return strstr(read_status(), want) != NULL;
+}
+
+/* ---------------- Driving ---------------- */
+static uint32_t next_target_ms;
+
+static int rand_int(int lo, int hi) { return lo + (int)(host_rand() * (hi - lo + 1)); }
+
+/* a new target every 0.3-1.5 s: straight-ish, curves, and some pivots */
+static void drive(void) {
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if ((int32_t)(now - next_target_ms) < 0) return;
+    int a = rand_int(-PROFILE_VMAX, PROFILE_VMAX);
+    int b = a + rand_int(-6000, 6000);
+    if (host_rand() < 0.25) b = -a;
+    if (b > PROFILE_VMAX) b = PROFILE_VMAX;
+    if (b < -PROFILE_VMAX) b = -PROFILE_VMAX;
+    profile_set_target((int16_t)a, (int16_t)b);
+    next_target_ms = now + (uint32_t)rand_int(300, 1500);
+}
+
+static bool driven(int wheel) {
+    int16_t out[2];
+    profile_get_output(&out[0], &out[1]);
+    return abs(out[wheel]) > DRIVEN_MIN;
+}
+
+/* 1: no faults, count detections */
+static unsigned long false_stalls(void) {
+    unsigned long c0 = stall_count();
+    for (uint32_t ms = 0; ms < FP_SECONDS * 1000u; ms++) {
+        drive();
+        step_ms();
+    }
+    return stall_count() - c0;
+}
+
+/* 2/3: drive 0.5-2.5 s, fault a wheel once it is driven, time the detection.
+ * Returns ms, or -1 if never seen: the command was still ramping and
+ * settled below the range the detector judges. */
+static int inject(int wheel, Fault f) {
+    const uint32_t give_up_ms = 5000;
+    uint32_t arm_ms = (uint32_t)rand_int(500, 2500), t = 0, t_fault = 0;
+    unsigned long c0 = stall_count();
+    bool on = false;
+    int lat = -1;
+
+    for (; t < give_up_ms; t++) {
+        if (!on) drive();   // the command stays put once the fault is in
+        step_ms();
+        if (!on && t >= arm_ms && driven(wheel)) {
+            fault[wheel] = f;
+            on = true;
+            t_fault = t;
+        }
+        if (!on) continue;
+        bool seen = f == F_STALL ? stall_count() != c0
+                  : reports(wheel, f == F_SLIP ? "slip" : "drag");
+        if (seen) { lat = (int)(t - t_fault); break; }
+    }
+    fault[wheel] = F_NONE;
+    /* back to a standstill so the next run starts clean */
+    profile_set_target(0, 0);
+    for (int i = 0; i < 400; i++) step_ms();
+    next_target_ms = 0;
+    return lat;
+}
+
+static int cmp_int(const void *a, const void *b) { return *(const int *)a - *(const int *)b; }
+
+static void latency(const char *name, Fault f, int runs) {
+    static int lat[INJECTIONS];
+    int n = 0, missed = 0;
+    double sum = 0;
+    for (int k = 0; k < runs; k++) {
+        int l = inject(k % 2, f);
+        if (l < 0) { missed++; continue; }
+        lat[n++] = l;
+        sum += l;
+    }
+    qsort(lat, n, sizeof lat[0], cmp_int);
+    if (n)
+        printf("%-6s %3d detected, %2d missed | ms: min %3d median %3d mean %5.1f max %3d\n",
+               name, n, missed, lat[0], lat[n / 2], sum / n, lat[n - 1]);
+    else
+        printf("%-6s none detected, %d missed\n", name, missed);
+}
+
+/* ---------------- 4: the stop holds ---------------- */
+static int failures;
+
+#define EXPECT(cond, what) do { if (!(cond)) { failures++; printf("FAIL: %s\n", what); } } while (0)
+
+static bool wait_pending(int wheel) {
+    profile_set_target(PROFILE_VMAX, PROFILE_VMAX);
+    for (int t = 0; t < 600; t++) step_ms();
+    fault[wheel] = F_STALL;
+    for (int t = 0; t < 400 && !stall_pending(); t++) step_ms();
+    fault[wheel] = F_NONE;
+    return stall_pending();
+}
+
+static void hold_checks(void) {
+    stall_set_recovery(STALL_REC_STOP, 0);
+    EXPECT(wait_pending(0), "stop mode: stall not raised");
+    EXPECT(duty_of(0) == 0.0 && duty_of(1) == 0.0, "stop mode: timer did not cut the motors");
+    EXPECT(stall_service(), "stop mode: service did not report the stall");
+    EXPECT(mission_aborts == 1, "stop mode: mission not dropped");
+    for (int t = 0; t < 1000; t++) step_ms();
+    EXPECT(stall_service(), "stop mode: hold lapsed on its own");
+    EXPECT(strstr(read_status(), " held") != NULL, "stop mode: status does not show the hold");
+    stall_release();
+    EXPECT(!stall_service(), "stop mode: release did not lift the hold");
+
+    stall_set_recovery(STALL_REC_AVOID, 0);
+    EXPECT(wait_pending(1), "avoid mode: stall not raised");
+    EXPECT(stall_service() && recoveries == 1, "avoid mode: recovery not started");
+    EXPECT(!stall_service(), "avoid mode: held after starting the recovery");
+
+    avoiding = true;   // stuck again during the side-step
+    int c0 = cancels;
+    EXPECT(wait_pending(1), "avoiding: stall not raised");
+    EXPECT(stall_service() && cancels == c0 + 1, "avoiding: avoidance not cancelled");
+    EXPECT(stall_service(), "avoiding: stop not held");
+    stall_set_recovery(STALL_REC_OFF, 0);
+    EXPECT(!stall_service(), "turning recovery off did not lift the hold");
+}
+
+int main(void) {
+    RoverParams rp;
+    params_defaults(&rp);
+    params_set(&rp);
+    host_srand(SEED);
+    motor_init_pins();
+    profile_init();
+    stall_init();
+    stall_set_recovery(STALL_REC_OFF, 0);
+
+    printf("false stalls in %d min of random driving: %lu\n", FP_SECONDS / 60, false_stalls());
+    latency("stall", F_STALL, INJECTIONS);
+    latency("slip", F_SLIP, 40);
+    latency("drag", F_DRAG, 40);
+
+    hold_checks();
+    if (failures) return 1;
+    printf("ok\n");
+    return 0;
+}
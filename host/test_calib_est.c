@@ -0,0 +1,172 @@
+// calib_estimate() against known ground truth.
+//
+// Each trial draws a rover that differs from the built-in defaults (wheel
+// size, track, motor speed, left/right mismatch, pivot rates, coast-down),
+// synthesises what calib.c would record driving it - straight run, spin
+// range samples, two timed pivots per side - with sensor noise, then checks
+// the estimates against the rover that produced them.
+
+#include <stdio.h>
+#include <math.h>
+#include "host_sdk.h"
+#include "calib_est.h"
+#include "params.h"
+
+#define TRIALS          500
+#define DRIVE_MS        1200     // calib.c CAL_DRIVE_MS
+#define SPIN_BURST_MS   120      // calib.c CAL_SPIN_BURST_MS
+#define SPIN_REVS       2.4      // calib.c CAL_SPIN_REVS
+#define MAX_SAMPLES     96
+#define WALL_MM         800.0
+#define ECHO_CONE_DEG   25.0
+
+/* Tolerances: worst case over all trials, and RMS. The straight run is
+ * ~200 mm measured with +-3 mm ranges at each end; the spin samples are
+ * ~15 deg apart, so the one-turn tick count is good to a few percent. */
+#define TOL_CIRCUM      0.035, 0.015   // fractions of the true value
+#define TOL_TRACK       0.08,  0.03
+#define TOL_PIVOT       0.08,  0.03
+#define TOL_DRIVE       0.035, 0.015
+#define TOL_TPS         0.01,  0.005
+#define TOL_BIAS_DEG    1.5,   0.6
+
+typedef struct {
+    double circum_mm, track_mm;
+    double tps_l, tps_r;         // straight, full duty
+    double pivot_tpms[2];        // ticks per ms while pivoting, per side
+    double coast_ticks[2];       // extra ticks after the stop
+} Truth;
+
+static double uniform(double lo, double hi) { return lo + (hi - lo) * host_rand(); }
+
+static Truth draw(const RoverParams *def) {
+    Truth t;
+    t.circum_mm = def->wheel_circum_mm * uniform(0.9, 1.1);
+    t.track_mm = def->track_width_mm * uniform(0.9, 1.1);
+    t.tps_l = def->full_speed_tps * uniform(0.8, 1.2);
+    t.tps_r = t.tps_l * uniform(0.96, 1.04);
+    for (int s = 0; s < 2; s++) {
+        t.pivot_tpms[s] = 0.5 * (t.tps_l + t.tps_r) / 1000.0 * uniform(0.85, 1.0);
+        t.coast_ticks[s] = uniform(2.0, 8.0);
+    }
+    return t;
+}
+
+static double rev_ticks(const Truth *t, const RoverParams *def) {
+    return M_PI * t->track_mm / (t->circum_mm / def->counts_per_rev);
+}
+
+/* range as the spin sweeps past a wall; other directions are far or silent */
+static uint32_t range_at(double ang) {
+    ang = fmod(ang, 2.0 * M_PI);
+    if (ang > M_PI) ang -= 2.0 * M_PI;
+    if (fabs(ang) < ECHO_CONE_DEG * M_PI / 180.0)
+        return (uint32_t)lround(WALL_MM / cos(ang) + uniform(-4.0, 4.0));
+    return host_rand() < 0.5 ? 0 : (uint32_t)uniform(1.6 * WALL_MM, 3000.0);
+}
+
+static CalibData record(const Truth *t, const RoverParams *def) {
+    CalibData d = {0};
+    const double mmpt = t->circum_mm / def->counts_per_rev;
+
+    d.drive_ms = DRIVE_MS;
+    d.drive_ticks_l = (uint32_t)lround(t->tps_l * DRIVE_MS / 1000.0);
+    d.drive_ticks_r = (uint32_t)lround(t->tps_r * DRIVE_MS / 1000.0);
+    double travel = 0.5 * (d.drive_ticks_l + d.drive_ticks_r) * mmpt;
+    d.wall_before_mm = (uint32_t)lround(1500.0 + uniform(-3.0, 3.0));
+    d.wall_after_mm = (uint32_t)lround(1500.0 - travel + uniform(-3.0, 3.0));
+
+    const double expected = def->track_width_mm * M_PI * def->counts_per_rev / def->wheel_circum_mm;
+    const double rev = rev_ticks(t, def);
+    for (int s = 0; s < 2; s++) {
+        SpinSample smp[MAX_SAMPLES];
+        int n = 0;
+        double ticks = 0.0, start = uniform(0.0, 2.0 * M_PI);
+        smp[n++] = (SpinSample){0.0f, range_at(start)};
+        while (ticks < SPIN_REVS * expected && n < MAX_SAMPLES) {
+            ticks += t->pivot_tpms[s] * SPIN_BURST_MS * uniform(0.9, 1.1) + t->coast_ticks[s];
+            smp[n++] = (SpinSample){(float)ticks, range_at(start + 2.0 * M_PI * ticks / rev)};
+        }
+        PivotRun *p = &d.pivot[s];
+        p->rev_ticks = calib_find_rev_ticks(smp, n, (float)expected);
+
+        uint16_t ms = s == 0 ? def->pivot_ms_90_left : def->pivot_ms_90_right;
+        for (int i = 0; i < 2; i++) {
+            p->test_ms[i] = i ? (uint16_t)(ms * 3 / 2) : ms;
+            p->test_ticks[i] = (float)(t->pivot_tpms[s] * p->test_ms[i] + t->coast_ticks[s] + uniform(-0.5, 0.5));
+        }
+    }
+    return d;
+}
+
+typedef struct { double worst, sq; int n; double tol_worst, tol_rms; } Check;
+
+static void check(Check *c, double err) {
+    err = fabs(err);
+    if (err > c->worst) c->worst = err;
+    c->sq += err * err;
+    c->n++;
+}
+
+static bool report(const char *name, const Check *c, double scale, const char *unit) {
+    double rms = c->n ? sqrt(c->sq / c->n) : 0.0;
+    bool ok = c->worst <= c->tol_worst && rms <= c->tol_rms;
+    printf("%-9s worst %5.2f%-4s rms %5.2f%-4s %s\n", name, c->worst * scale, unit, rms * scale, unit,
+           ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(void) {
+    RoverParams def;
+    params_defaults(&def);
+    host_srand(28);
+
+    Check circum = {0, 0, 0, TOL_CIRCUM}, track = {0, 0, 0, TOL_TRACK}, pivot = {0, 0, 0, TOL_PIVOT};
+    Check drive = {0, 0, 0, TOL_DRIVE}, tps = {0, 0, 0, TOL_TPS}, bias = {0, 0, 0, TOL_BIAS_DEG};
+    int rejected = 0, unflagged = 0;
+    for (int k = 0; k < TRIALS; k++) {
+        Truth t = draw(&def);
+        CalibData d = record(&t, &def);
+        RoverParams p = def;
+        if (!calib_estimate(&d, &p) || d.pivot[0].rev_ticks <= 0.0f || d.pivot[1].rev_ticks <= 0.0f) {
+            rejected++;
+            continue;
+        }
+
+        const double mmpt = t.circum_mm / def.counts_per_rev;
+        const double speed = 0.5 * (t.tps_l + t.tps_r) * mmpt / 1000.0;       // mm/ms
+        const double drive_ms = CALIB_SIDESTEP_MM / speed;
+        const double drift_deg = (t.tps_r - t.tps_l) * mmpt / 1000.0 * drive_ms / t.track_mm * 180.0 / M_PI;
+
+        check(&circum, p.wheel_circum_mm / t.circum_mm - 1.0);
+        check(&track, p.track_width_mm / t.track_mm - 1.0);
+        for (int s = 0; s < 2; s++) {
+            double ms90 = (rev_ticks(&t, &def) / 4.0 - t.coast_ticks[s]) / t.pivot_tpms[s];
+            double got = s == 0 ? p.pivot_ms_90_left : p.pivot_ms_90_right;
+            check(&pivot, got / ms90 - 1.0);
+        }
+        check(&drive, p.drive_ms / drive_ms - 1.0);
+        check(&tps, p.full_speed_tps / (0.5 * (t.tps_l + t.tps_r)) - 1.0);
+        check(&bias, p.turnback_bias_deg - drift_deg);
+        if (!p.bias_measured) unflagged++;   // else the FSM adds it to both sides
+    }
+
+    printf("%d trials, %d rejected\n", TRIALS, rejected);
+    bool ok = rejected <= TRIALS / 100;
+    if (unflagged) {
+        printf("%d estimates left bias_measured clear\n", unflagged);
+        ok = false;
+    }
+    ok &= report("circum", &circum, 100, "%");
+    ok &= report("track", &track, 100, "%");
+    ok &= report("pivot90", &pivot, 100, "%");
+    ok &= report("drive", &drive, 100, "%");
+    ok &= report("full tps", &tps, 100, "%");
+    ok &= report("bias", &bias, 1, " deg");
+    if (!ok) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+// mission_load() staging: what the UDP callback queues between two
+// mission_tick() passes, and appends that would not fit.
+//   - "mission" then "mission_append" before the main loop picks up the
+//     load: the replacement runs with the appended steps on its tail
+//   - two appends in one pass merge
+//   - an append that overflows the live queue is refused whole
+//   - "mission_abort" then "mission_append": a fresh mission, not an
+//     append to the one that was aborted
+
+#include <stdio.h>
+#include <string.h>
+#include "host_sdk.h"
+#include "encoder.h"
+#include "params.h"
+#include "mission.h"
+
+void encoder_get_ticks(uint32_t *l, uint32_t *r) { *l = *r = 0; }
+void encoder_get_last_edge_us(uint32_t *l, uint32_t *r) { *l = *r = 0; }
+float encoder_mm_per_tick(void) { return params_get()->wheel_circum_mm / params_get()->counts_per_rev; }
+bool ultra_is_avoiding(void) { return false; }
+
+static int failures = 0;
+
+#define EXPECT(cond, ...) do { if (!(cond)) { failures++; printf("FAIL: " __VA_ARGS__); printf("\n"); } } while (0)
+
+/* one main-loop pass; fills in done/total from the "M:" line */
+static DriveCmd tick(unsigned *done, unsigned *total) {
+    DriveCmd out = CMD_STOP;
+    char buf[128] = "";
+    host_run_ms(20);
+    mission_tick(&out);
+    mission_format_status(buf, sizeof buf);
+    if (sscanf(buf, "M: state=%*s | step=%u/%u", done, total) != 2) *done = *total = 0;
+    return out;
+}
+
+/* n timed steps of cmd, as one upload */
+static const char *steps(int n, const char *cmd) {
+    static char text[512];
+    text[0] = '\0';
+    for (int i = 0; i < n; i++)
+        snprintf(text + strlen(text), sizeof text - strlen(text), "t %s 1000; ", cmd);
+    return text;
+}
+
+static void append_to_staged_load(void) {
+    unsigned done, total;
+    mission_load(steps(4, "forward"), false);
+    tick(&done, &total);
+    tick(&done, &total);
+
+    EXPECT(mission_load(steps(2, "left"), false) == 2, "replacement refused");
+    EXPECT(mission_load(steps(1, "right"), true) == 1, "append to a staged load refused");
+    DriveCmd out = tick(&done, &total);
+    EXPECT(out == CMD_LEFT && done == 0 && total == 3,
+           "load + append in one pass: cmd %d, step %u/%u (want left, 0/3)", out, done, total);
+}
+
+static void appends_merge(void) {
+    unsigned done, total;
+    mission_load(steps(2, "forward"), false);
+    tick(&done, &total);
+    mission_load(steps(3, "left"), true);
+    mission_load(steps(4, "right"), true);
+    DriveCmd out = tick(&done, &total);
+    EXPECT(out == CMD_FORWARD && total == 9, "two appends in one pass: %u steps (want 9)", total);
+}
+
+static void overflow_refused(void) {
+    unsigned done, total;
+    mission_load(steps(MISSION_MAX_STEPS - 4, "forward"), false);
+    tick(&done, &total);
+    EXPECT(mission_load(steps(2, "left"), true) == 2, "append that fits refused");
+    EXPECT(mission_load(steps(3, "left"), true) == 0, "append past MISSION_MAX_STEPS accepted");
+    tick(&done, &total);
+    EXPECT(total == MISSION_MAX_STEPS - 2, "after a refused append: %u steps (want %d)",
+           total, MISSION_MAX_STEPS - 2);
+    EXPECT(mission_load(steps(2, "right"), true) == 2, "append that fits the rest refused");
+    tick(&done, &total);
+    EXPECT(total == MISSION_MAX_STEPS, "full queue: %u steps (want %d)", total, MISSION_MAX_STEPS);
+}
+
+static void abort_then_append(void) {
+    unsigned done, total;
+    mission_load(steps(3, "forward"), false);
+    tick(&done, &total);
+    mission_abort();
+    EXPECT(mission_load(steps(1, "left"), true) == 1, "append after abort refused");
+    DriveCmd out = tick(&done, &total);
+    EXPECT(out == CMD_LEFT && total == 1,
+           "abort + append in one pass: cmd %d, %u steps (want left, 1)", out, total);
+}
+
+int main(void) {
+    RoverParams rp;
+    params_defaults(&rp);
+    params_set(&rp);
+
+    append_to_staged_load();
+    appends_merge();
+    overflow_refused();
+    abort_then_append();
+
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,202 @@
+// motor.c output path: command table -> profile -> CC words.
+//
+// Walks every command-to-command transition in both stop modes, looking
+// at the CC registers after each profile tick:
+//   - each wheel's word is coast, forward, reverse or brake, never a mix
+//     (both inputs driven at once would short the bridge or fight it)
+//   - a wheel only ever goes from its old direction through zero to its
+//     new one, never the wrong way for a tick
+//   - the end state is the command's row at full duty
+//   - at zero the wheel is in the configured stop mode
+//   - both wheels' words take effect on the same PWM wrap, never one a
+//     period before the other (the ticks land at random counter phases)
+// Then writes from every counter position, through the guard band before
+// the wrap, and finds how long a stall between reading the counter and the
+// stores it takes to split a pair (why the write path lives in RAM).
+// Last, checks that motor_halt() does not change the configured stop mode.
+
+#include <stdio.h>
+#include "host_sdk.h"
+#include "hardware/pwm.h"
+#include "motor.h"
+#include "profile.h"
+
+#define SLICE_L   4          // GP8/9
+#define SLICE_R   5          // GP10/11
+#define PWM_FULL  6250
+#define SETTLE_MS (2 * PROFILE_RAMP_MS + 20)
+#define WRAP_GUARD 64        // motor.c
+
+static const int8_t EXPECT[CMD_COUNT][2] = {
+    [CMD_STOP]      = { 0,  0},
+    [CMD_FORWARD]   = { 1,  1},
+    [CMD_BACKWARD]  = {-1, -1},
+    [CMD_LEFT]      = {-1,  1},
+    [CMD_RIGHT]     = { 1, -1},
+    [CMD_FWD_LEFT]  = { 0,  1},
+    [CMD_FWD_RIGHT] = { 1,  0},
+    [CMD_BWD_LEFT]  = { 0, -1},
+    [CMD_BWD_RIGHT] = {-1,  0},
+};
+
+static const char *NAMES[CMD_COUNT] = {
+    "stop", "forward", "backward", "left", "right", "fwd_left", "fwd_right", "bwd_left", "bwd_right"
+};
+
+typedef enum { W_COAST, W_FWD, W_REV, W_BRAKE, W_MIXED } WheelWord;
+
+static int failures = 0;
+
+#define FAIL(...) do { if (failures++ < 20) { printf("FAIL: " __VA_ARGS__); printf("\n"); } } while (0)
+
+static WheelWord decode(uint32_t cc, uint32_t *level) {
+    uint32_t a = cc & 0xffff, b = cc >> 16;
+    *level = a > b ? a : b;
+    if (!a && !b) return W_COAST;
+    if (a && !b) return W_FWD;
+    if (!a && b) return W_REV;
+    if (a == PWM_FULL && b == PWM_FULL) return W_BRAKE;
+    return W_MIXED;
+}
+
+static bool same_wrap(void) {
+    return host_pwm_latch_wrap(SLICE_L) == host_pwm_latch_wrap(SLICE_R);
+}
+
+static int sign_of(WheelWord w) { return w == W_FWD ? 1 : w == W_REV ? -1 : 0; }
+
+static WheelWord wheel(int k, uint32_t *level) {
+    return decode(pwm_hw->slice[k ? SLICE_R : SLICE_L].cc, level);
+}
+
+/* one transition; from has already settled */
+static void walk(DriveCmd from, DriveCmd to, MotorStopMode mode) {
+    const WheelWord stop_word = mode == MOTOR_BRAKE ? W_BRAKE : W_COAST;
+    bool left_start[2] = {false, false};
+
+    motor_apply(to);
+    for (int ms = 0; ms < SETTLE_MS; ms++) {
+        host_pwm_skew((uint32_t)(host_rand() * PWM_FULL));
+        host_run_ms(1);
+        if (!same_wrap())
+            FAIL("%s -> %s: wheels latched on wraps %llu / %llu", NAMES[from], NAMES[to],
+                 (unsigned long long)host_pwm_latch_wrap(SLICE_L),
+                 (unsigned long long)host_pwm_latch_wrap(SLICE_R));
+        int8_t dir[2];
+        motor_get_dir(&dir[0], &dir[1]);
+        for (int k = 0; k < 2; k++) {
+            uint32_t level;
+            WheelWord w = wheel(k, &level);
+            int s = sign_of(w), s0 = EXPECT[from][k], s1 = EXPECT[to][k];
+            /* the first step off zero can round to a level of 0 */
+            if (w == W_COAST && dir[k]) s = dir[k];
+            if (w == W_MIXED) {
+                FAIL("%s -> %s: wheel %d cc=%08lx is mixed", NAMES[from], NAMES[to], k,
+                     (unsigned long)pwm_hw->slice[k ? SLICE_R : SLICE_L].cc);
+                continue;
+            }
+            if (s == 0 && w != stop_word)
+                FAIL("%s -> %s: wheel %d at zero is not in the stop mode", NAMES[from], NAMES[to], k);
+            if (s != 0 && s != s0 && s != s1)
+                FAIL("%s -> %s: wheel %d driven the wrong way", NAMES[from], NAMES[to], k);
+            if (s != s0) left_start[k] = true;
+            else if (left_start[k] && s0 != s1)
+                FAIL("%s -> %s: wheel %d went back to its old direction", NAMES[from], NAMES[to], k);
+            if (dir[k] != s)
+                FAIL("%s -> %s: wheel %d motor_get_dir %d, driven %d", NAMES[from], NAMES[to], k, dir[k], s);
+        }
+    }
+
+    for (int k = 0; k < 2; k++) {
+        uint32_t level;
+        WheelWord w = wheel(k, &level);
+        if (sign_of(w) != EXPECT[to][k] || (EXPECT[to][k] && level != PWM_FULL))
+            FAIL("%s -> %s: wheel %d ends as state %d level %lu", NAMES[from], NAMES[to], k, w,
+                 (unsigned long)level);
+    }
+}
+
+static void expect_both(WheelWord want, const char *what) {
+    uint32_t level;
+    if (wheel(0, &level) != want || wheel(1, &level) != want) FAIL("%s", what);
+}
+
+/* one pair written with the counter at ctr when motor.c first reads it */
+static bool split_at(uint32_t ctr, uint32_t stall, int16_t v) {
+    host_pwm_set_phase(SLICE_L, ctr);
+    host_pwm_stall_next_store(stall);
+    motor_write(v, (int16_t)-v);
+    return !same_wrap();
+}
+
+static void guard_band(void) {
+    for (uint32_t ctr = 0; ctr < PWM_FULL; ctr++)
+        if (split_at(ctr, 0, (int16_t)(ctr & 1 ? 20000 : -9000)))
+            FAIL("write from ctr=%lu latched the wheels on different wraps", (unsigned long)ctr);
+
+    /* smallest stall after the counter read that splits a pair somewhere */
+    uint32_t worst = 0;
+    for (uint32_t stall = 1; stall <= 4 * WRAP_GUARD && !worst; stall++)
+        for (uint32_t ctr = PWM_FULL - 2 * WRAP_GUARD; ctr < PWM_FULL && !worst; ctr++)
+            if (split_at(ctr, stall, (int16_t)(ctr & 1 ? 20000 : -9000))) worst = stall;
+    printf("guard %d cycles: a stall of %lu cycles between counter read and stores splits a pair\n",
+           WRAP_GUARD, (unsigned long)worst);
+    if (!worst) FAIL("no stall up to %d cycles split a pair: the wrap check sees nothing", 4 * WRAP_GUARD);
+    motor_write(0, 0);
+}
+
+static void halt_keeps_stop_mode(void) {
+    /* brake configured; a coast halt holds coast, the next stop brakes again */
+    motor_set_stop_mode(MOTOR_BRAKE);
+    motor_apply(CMD_FORWARD);
+    host_run_ms(SETTLE_MS);
+    motor_halt(MOTOR_COAST);
+    expect_both(W_COAST, "coast halt did not coast");
+    host_run_ms(50);
+    expect_both(W_COAST, "coast halt undone by the profile tick");
+    motor_apply(CMD_FORWARD);
+    host_run_ms(SETTLE_MS);
+    motor_apply(CMD_STOP);
+    host_run_ms(SETTLE_MS);
+    expect_both(W_BRAKE, "coast halt changed the brake stop mode");
+
+    /* and the other way round */
+    motor_set_stop_mode(MOTOR_COAST);
+    motor_apply(CMD_BACKWARD);
+    host_run_ms(SETTLE_MS);
+    motor_halt(MOTOR_BRAKE);
+    expect_both(W_BRAKE, "brake halt did not brake");
+    host_run_ms(50);
+    expect_both(W_BRAKE, "brake halt undone by the profile tick");
+    motor_apply(CMD_LEFT);
+    host_run_ms(SETTLE_MS);
+    motor_apply(CMD_STOP);
+    host_run_ms(SETTLE_MS);
+    expect_both(W_COAST, "brake halt changed the coast stop mode");
+}
+
+int main(void) {
+    motor_init_pins();
+    profile_init();
+
+    int walked = 0;
+    for (int m = 0; m < 2; m++) {
+        MotorStopMode mode = m ? MOTOR_BRAKE : MOTOR_COAST;
+        motor_set_stop_mode(mode);
+        for (int a = 0; a < CMD_COUNT; a++) {
+            for (int b = 0; b < CMD_COUNT; b++) {
+                motor_apply((DriveCmd)a);
+                host_run_ms(SETTLE_MS);
+                walk((DriveCmd)a, (DriveCmd)b, mode);
+                walked++;
+            }
+        }
+    }
+    guard_band();
+    halt_keeps_stop_mode();
+
+    printf("%d transitions walked, %d failures\n", walked, failures);
+    if (failures) return 1;
+    printf("ok\n");
+    return 0;
+}
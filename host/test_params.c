@@ -0,0 +1,99 @@
+// params.c flash block: save/load round trip, and version 1 blocks (saved
+// before bias_measured existed) loading with the right bias meaning.
+//   - a calibrated v1 block: the bias is a measured drift
+//   - a v1 block of the defaults ("calib_defaults"): hand-tuned, both sides
+//   - a blank or corrupt sector: the defaults
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "host_sdk.h"
+#include "hardware/flash.h"
+#include "params.h"
+
+#define SECTOR   (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define V1_SIZE  offsetof(RoverParams, bias_measured)
+
+static int failures = 0;
+
+#define EXPECT(cond, ...) do { if (!(cond)) { failures++; printf("FAIL: " __VA_ARGS__); printf("\n"); } } while (0)
+
+static uint32_t crc32(const uint8_t *d, size_t n) {
+    uint32_t c = 0xFFFFFFFFu;
+    while (n--) {
+        c ^= *d++;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+    }
+    return ~c;
+}
+
+/* the block as version 1 wrote it: magic, version, size, params, crc */
+static void write_v1(const RoverParams *p) {
+    uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t magic = 0x52505231u, crc = crc32((const uint8_t *)p, V1_SIZE);
+    uint16_t version = 1, size = V1_SIZE;
+    memset(page, 0xff, sizeof page);
+    memcpy(page, &magic, 4);
+    memcpy(page + 4, &version, 2);
+    memcpy(page + 6, &size, 2);
+    memcpy(page + 8, p, V1_SIZE);
+    memcpy(page + 8 + V1_SIZE, &crc, 4);
+    flash_range_erase(SECTOR, FLASH_SECTOR_SIZE);
+    flash_range_program(SECTOR, page, sizeof page);
+}
+
+static bool same(const RoverParams *a, const RoverParams *b) {
+    return memcmp(a, b, V1_SIZE) == 0 && a->bias_measured == b->bias_measured;
+}
+
+int main(void) {
+    RoverParams def, cal;
+    params_defaults(&def);
+    EXPECT(def.bias_measured == 0, "defaults claim a measured bias");
+
+    cal = def;
+    cal.pivot_ms_90_left = 262;
+    cal.turnback_bias_deg = -3;
+    cal.bias_measured = 1;
+
+    /* v2 round trip */
+    params_set(&cal);
+    EXPECT(params_save(), "save failed");
+    params_set(&def);
+    params_load();
+    EXPECT(same(params_get(), &cal), "v2 block did not round-trip");
+
+    /* v1, calibrated */
+    RoverParams v1 = cal;
+    v1.bias_measured = 0;   // not in the v1 block
+    write_v1(&v1);
+    params_load();
+    EXPECT(same(params_get(), &cal), "calibrated v1 block: bias_measured %d, bias %d (want 1, -3)",
+           params_get()->bias_measured, params_get()->turnback_bias_deg);
+
+    /* v1, the defaults */
+    write_v1(&def);
+    params_load();
+    EXPECT(same(params_get(), &def), "v1 defaults block: bias_measured %d (want 0)",
+           params_get()->bias_measured);
+
+    /* v1, corrupt */
+    write_v1(&v1);
+    host_flash[SECTOR + 10] ^= 0x40;
+    params_set(&cal);
+    params_load();
+    EXPECT(same(params_get(), &def), "corrupt v1 block was loaded");
+
+    /* blank */
+    flash_range_erase(SECTOR, FLASH_SECTOR_SIZE);
+    params_set(&cal);
+    params_load();
+    EXPECT(same(params_get(), &def), "blank sector did not give the defaults");
+
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,185 @@
+// telemetry.c subscription table and fan-out, against the stand-in lwIP in
+// sdk/ (udp_sendto() logs instead of sending).
+//   - a channel is encoded once per tick and the one pbuf goes to every
+//     subscriber due then
+//   - odom ticks= / rpm / speed are over a fixed window, the same whatever
+//     other subscribers are asking for
+//   - capacity: listeners stop short of the controller reserve, and a
+//     controller still gets odom + fsm with the table full of them
+//   - an unsubscribed slot is reused; an expired lease stops the stream
+//     and frees its slot
+
+#include <stdio.h>
+#include <string.h>
+#include "host_sdk.h"
+#include "encoder.h"
+#include "ultrasonic.h"
+#include "stall.h"
+#include "mission.h"
+#include "calib.h"
+#include "diag.h"
+#include "params.h"
+#include "telemetry.h"
+
+#define PORT           5001
+#define TICKS_PER_MS   2
+#define CONTROLLERS    2         // a driver station and a mission uploader
+
+/* ---------------- Stand-ins for the rest of the firmware ---------------- */
+static int fsm_encodes;
+
+void encoder_get_ticks(uint32_t *l, uint32_t *r) { *l = *r = to_ms_since_boot(get_absolute_time()) * TICKS_PER_MS; }
+float encoder_mm_per_tick(void) { return params_get()->wheel_circum_mm / params_get()->counts_per_rev; }
+uint32_t ultra_last_cm(void) { return 42; }
+int ultra_format_status(char *buf, size_t n) { fsm_encodes++; return snprintf(buf, n, "A: state=clear\r\n"); }
+int stall_format_status(char *buf, size_t n) { return snprintf(buf, n, "S: ok\r\n"); }
+int mission_format_status(char *buf, size_t n) { return 0; }
+int calib_format_status(char *buf, size_t n) { return 0; }
+void diag_count(DiagCounter c) {}
+int diag_format(char *buf, size_t n) { return snprintf(buf, n, "diag\r\n"); }
+
+/* ---------------- Helpers ---------------- */
+static int failures = 0;
+
+#define EXPECT(cond, ...) do { if (!(cond)) { failures++; printf("FAIL: " __VA_ARGS__); printf("\n"); } } while (0)
+
+/* 192.168.1.host */
+static ip_addr_t ip(int host) { return (ip_addr_t){0x0001a8c0u | (uint32_t)host << 24}; }
+
+/* the reply to a sub/unsub, or "" */
+static const char *cmd(int host, const char *text) {
+    ip_addr_t a = ip(host);
+    host_udp_sent = 0;
+    telemetry_handle_cmd(text, &a, PORT);
+    return host_udp_sent ? host_udp_log[host_udp_sent - 1].text : "";
+}
+
+static void touch(int host) {
+    ip_addr_t a = ip(host);
+    telemetry_touch(&a, PORT);
+}
+
+/* datagrams logged to host that start with prefix */
+static int sent_to(int host, const char *prefix) {
+    int n = 0;
+    for (int i = 0; i < host_udp_sent && i < HOST_UDP_LOG; i++)
+        if (host_udp_log[i].addr == ip(host).addr && strncmp(host_udp_log[i].text, prefix, strlen(prefix)) == 0) n++;
+    return n;
+}
+
+static bool starts(const char *s, const char *prefix) { return strncmp(s, prefix, strlen(prefix)) == 0; }
+
+/* ---------------- Cases ---------------- */
+static void encode_once(void) {
+    for (int h = 1; h <= 5; h++) cmd(h, "sub fsm 100");
+    host_udp_sent = 0;
+    fsm_encodes = 0;
+    host_run_ms(1000);
+
+    /* due on the first tick, then every 100 ms up to and including 1 s */
+    EXPECT(fsm_encodes == 11, "fsm encoded %d times in 1 s at 100 ms (want 11)", fsm_encodes);
+    EXPECT(host_udp_sent == 5 * fsm_encodes, "%d datagrams for %d samples to 5 subscribers",
+           host_udp_sent, fsm_encodes);
+    for (int i = 0; i + 5 <= host_udp_sent; i += 5)
+        for (int k = 1; k < 5; k++)
+            EXPECT(host_udp_log[i + k].p == host_udp_log[i].p, "sample %d copied per subscriber", i / 5);
+    EXPECT(host_pbufs_live == 0, "%d pbufs left allocated", host_pbufs_live);
+
+    for (int h = 1; h <= 5; h++) cmd(h, "unsub all");
+}
+
+/* ticks= from every odom datagram to host; -1 if any differ */
+static long odom_ticks(int host) {
+    long ticks = -2;
+    for (int i = 0; i < host_udp_sent && i < HOST_UDP_LOG; i++) {
+        unsigned long t;
+        if (host_udp_log[i].addr != ip(host).addr || sscanf(host_udp_log[i].text, "L: ticks=%lu", &t) != 1)
+            continue;
+        if (ticks == -2) ticks = (long)t;
+        else if (ticks != (long)t) return -1;
+    }
+    return ticks;
+}
+
+static void odom_window(void) {
+    const long want = 500 * TICKS_PER_MS;
+    cmd(10, "sub odom 100");
+    host_run_ms(600);
+    host_udp_sent = 0;
+    host_run_ms(1000);
+    EXPECT(odom_ticks(10) == want, "odom alone: ticks=%ld (want %ld)", odom_ticks(10), want);
+
+    cmd(11, "sub odom 20");
+    host_udp_sent = 0;
+    host_run_ms(1000);
+    EXPECT(odom_ticks(10) == want, "odom at 100 ms beside one at 20 ms: ticks=%ld (want %ld)",
+           odom_ticks(10), want);
+    EXPECT(odom_ticks(11) == want, "odom at 20 ms: ticks=%ld (want %ld)", odom_ticks(11), want);
+
+    cmd(10, "unsub all");
+    cmd(11, "unsub all");
+}
+
+/* hosts 20.. are listeners, 40.. controllers */
+static void capacity(void) {
+    const int listeners = TELEM_MAX_SUBS - TELEM_CTRL_SUBS;
+    int ok = 0;
+    for (int h = 20; h < 20 + TELEM_MAX_SUBS; h++) {
+        const char *r = cmd(h, "sub range 100 2000");
+        if (starts(r, "sub ok")) ok++;
+        else EXPECT(starts(r, "sub full") && h >= 20 + listeners, "listener %d: %s", h - 20, r);
+    }
+    EXPECT(ok == listeners, "%d listeners taken (want %d)", ok, listeners);
+
+    for (int h = 40; h < 40 + CONTROLLERS; h++) touch(h);
+    host_udp_sent = 0;
+    host_run_ms(600);
+    for (int h = 40; h < 40 + CONTROLLERS; h++)
+        EXPECT(sent_to(h, "L:") >= 1 && sent_to(h, "A:") >= 1,
+               "controller %d with the table full: %d odom, %d fsm", h - 40, sent_to(h, "L:"), sent_to(h, "A:"));
+    EXPECT(starts(cmd(20 + listeners, "sub range 100"), "sub full"), "a listener past the controller reserve was taken");
+
+    /* a controller that also subscribes keeps its one entry */
+    EXPECT(starts(cmd(40, "sub diag 100 2000"), "sub ok"), "controller refused a subscription of its own");
+
+    EXPECT(starts(cmd(20, "unsub all"), "unsub ok 1"), "unsub of a listener");
+    EXPECT(starts(cmd(20 + listeners, "sub range 100 2000"), "sub ok"), "freed slot not reused");
+    EXPECT(starts(cmd(20, "sub range 100"), "sub full"), "reused slot handed out twice");
+}
+
+static void lease_expiry(void) {
+    host_run_ms(2500);   // past every listener lease from capacity()
+    host_udp_sent = 0;
+    host_run_ms(500);
+    int late = 0;
+    for (int h = 20; h < 20 + TELEM_MAX_SUBS; h++) late += sent_to(h, "U:");
+    EXPECT(late == 0, "%d range samples after the leases ran out", late);
+    EXPECT(sent_to(40, "diag") == 0, "diag sample after its lease ran out");
+    EXPECT(sent_to(40, "L:") >= 1, "controller stream stopped with the other leases");
+
+    int ok = 0;
+    for (int h = 60; h < 60 + TELEM_MAX_SUBS - TELEM_CTRL_SUBS; h++)
+        ok += starts(cmd(h, "sub range 100 2000"), "sub ok");
+    EXPECT(ok == TELEM_MAX_SUBS - TELEM_CTRL_SUBS, "only %d slots free after expiry", ok);
+}
+
+int main(void) {
+    RoverParams rp;
+    static struct udp_pcb pcb;
+    params_defaults(&rp);
+    params_set(&rp);
+    host_run_ms(1000);
+    telemetry_init(&pcb);
+
+    encode_once();
+    odom_window();
+    capacity();
+    lease_expiry();
+
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -26,11 +26,21 @@
 #define TCP_MSS                         (1500 - 20 - 20)
 #define TCP_SND_BUF                     (2 * TCP_MSS)
 #define TCP_WND                         (TCP_MSS)
+#define MEM_SIZE                        4000  // heap for PBUF_RAM: telemetry payload + one header per subscriber
 #define PBUF_POOL_SIZE                  6
 #define MEMP_NUM_SYS_TIMEOUT            8
 
 // --- misc ---
-#define LWIP_STATS                      0
+#define LWIP_STATS                      1     // read by drivers/diag.c ("diag" command)
+#define LWIP_STATS_DISPLAY              0
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
+#define LINK_STATS                      1
+#define IP_STATS                        1
+#define UDP_STATS                       1
+#define TCP_STATS                       0
+#define ICMP_STATS                      0
+#define SYS_STATS                       0
 #define LWIP_PROVIDE_ERRNO              1
 #define ETH_PAD_SIZE                    0
 
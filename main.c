@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "pico/stdlib.h"
 
 // --- Application Includes ---
@@ -10,14 +11,22 @@
 
 // --- DRIVER INCLUDES ---
 #include "drivers/motor.h"
+#include "drivers/profile.h"
 #include "drivers/encoder.h"
 #include "drivers/ultrasonic.h"   
+#include "drivers/mission.h"
+#include "drivers/params.h"
+#include "drivers/calib.h"
+#include "drivers/diag.h"
+#include "drivers/telemetry.h"
+#include "drivers/stall.h"
 
 // ========== APPLICATION SETTINGS ==========
 #define WIFI_SSID "Diva iPhone"
 #define WIFI_PASS "91902017"
 #define CTRL_PORT 5000
 #define TELEMETRY_PORT 5001
+#define TELEOP_TIMEOUT_MS 600   // no teleop packet for this long -> stop
 
 // ========== APPLICATION GLOBALS ==========
 static struct udp_pcb *udp_server = NULL;
@@ -26,6 +35,13 @@ static struct udp_pcb *udp_server = NULL;
 // Ultrasonic will either forward it or temporarily override to avoid obstacles.
 static volatile DriveCmd g_desired_cmd = CMD_STOP;
 
+// Analog teleop ("vel <l%> <r%>") replaces g_desired_cmd while g_vel_mode is set.
+static volatile bool g_vel_mode = false;
+static volatile int16_t g_vel_left = 0, g_vel_right = 0;   // Q15, see PROFILE_VMAX
+
+// Clients send on change plus a keepalive; silence means the link is gone.
+static volatile uint32_t g_last_teleop_ms = 0;
+
 // ==========================================================
 //               TELEOP UDP FUNCTIONS
 // ==========================================================
@@ -46,28 +62,172 @@ static bool contains_cmd(const char *buf, const char *tok) {
     return false;
 }
 
+// Reply to a client on its telemetry port
+static void send_text(struct udp_pcb *pcb, const ip_addr_t *addr, const char *text, int len) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if (!p) {
+        diag_count(DIAG_TELEM_ALLOC_FAIL);
+        return;
+    }
+    memcpy(p->payload, text, len);
+    if (udp_sendto(pcb, p, addr, TELEMETRY_PORT) != ERR_OK) diag_count(DIAG_TELEM_SEND_FAIL);
+    pbuf_free(p);
+}
+
+static void send_diag(struct udp_pcb *pcb, const ip_addr_t *addr) {
+    static char report[768];
+    int len = diag_format(report, sizeof(report));
+    send_text(pcb, addr, report, len);
+}
+
+// Map incoming text to our desired command (do NOT call motor_* here).
+static DriveCmd text_to_cmd(const char *buf) {
+    if      (contains_cmd(buf, "forward_left"))     return CMD_FWD_LEFT;
+    else if (contains_cmd(buf, "forward_right"))    return CMD_FWD_RIGHT;
+    else if (contains_cmd(buf, "backward_left"))    return CMD_BWD_LEFT;
+    else if (contains_cmd(buf, "backward_right"))   return CMD_BWD_RIGHT;
+    else if (contains_cmd(buf, "forward"))          return CMD_FORWARD;
+    else if (contains_cmd(buf, "backward"))         return CMD_BACKWARD;
+    else if (contains_cmd(buf, "left"))             return CMD_LEFT;
+    else if (contains_cmd(buf, "right"))            return CMD_RIGHT;
+    else                                            return CMD_STOP;
+}
+
+// "stall <off|stop|avoid> [backoff_ms]"
+static bool parse_stall(const char *s) {
+    static const char *MODES[] = {"off", "stop", "avoid"};
+    while (*s == ' ') s++;
+    for (int m = 0; m < 3; m++) {
+        size_t k = strlen(MODES[m]);
+        if (strncmp(s, MODES[m], k) != 0) continue;
+        char *end;
+        long ms = strtol(s + k, &end, 10);
+        if (end == s + k) ms = 0;
+        else if (ms < 50 || ms > 3000) return false;
+        stall_set_recovery((StallRecovery)m, (uint16_t)ms);
+        return true;
+    }
+    return false;
+}
+
+// "vel <left%> <right%>", each -100..100
+static bool parse_vel(const char *s, int16_t *l, int16_t *r) {
+    char *end;
+    long a = strtol(s, &end, 10); if (end == s) return false;
+    s = end;
+    long b = strtol(s, &end, 10); if (end == s) return false;
+    if (a < -100 || a > 100 || b < -100 || b > 100) return false;
+    *l = (int16_t)(a * PROFILE_VMAX / 100);
+    *r = (int16_t)(b * PROFILE_VMAX / 100);
+    return true;
+}
+
 static void udp_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
                         const ip_addr_t *addr, u16_t port) {
     if (!p) return;
 
-    char buf[128];
-    size_t len = (p->len < sizeof(buf) - 1) ? p->len : sizeof(buf) - 1;
-    memcpy(buf, p->payload, len);
+    // Sized for a batched mission upload; static keeps it off the stack.
+    static char buf[512];
+    u16_t len = pbuf_copy_partial(p, buf, sizeof(buf) - 1, 0);
     buf[len] = '\0';
+    diag_count(DIAG_CTRL_RX);
+
+    // Latency probe: echo the token straight back ("ping 123" -> "pong 123")
+    if (strncmp(buf, "ping", 4) == 0) {
+        buf[1] = 'o';
+        send_text(pcb, addr, buf, len);
+        pbuf_free(p);
+        return;
+    }
 
-    // Map incoming text to our desired command (do NOT call motor_* here).
-    if      (contains_cmd(buf, "forward_left"))     g_desired_cmd = CMD_FWD_LEFT;
-    else if (contains_cmd(buf, "forward_right"))    g_desired_cmd = CMD_FWD_RIGHT;
-    else if (contains_cmd(buf, "backward_left"))    g_desired_cmd = CMD_BWD_LEFT;
-    else if (contains_cmd(buf, "backward_right"))   g_desired_cmd = CMD_BWD_RIGHT;
-    else if (contains_cmd(buf, "forward"))          g_desired_cmd = CMD_FORWARD;
-    else if (contains_cmd(buf, "backward"))         g_desired_cmd = CMD_BACKWARD;
-    else if (contains_cmd(buf, "left"))             g_desired_cmd = CMD_LEFT;
-    else if (contains_cmd(buf, "right"))            g_desired_cmd = CMD_RIGHT;
-    else                                            g_desired_cmd = CMD_STOP;
+    // Diagnostics on demand: reply straight to the sender's telemetry port
+    if (strncmp(buf, "diag", 4) == 0) {
+        send_diag(pcb, addr);
+        pbuf_free(p);
+        return;
+    }
+
+    // Mission uploads: "mission <steps>", "mission_append <steps>", "mission_abort"
+    if (strncmp(buf, "mission", 7) == 0) {
+        if (strncmp(buf, "mission_abort", 13) == 0) {
+            mission_abort();
+        } else {
+            bool append = strncmp(buf, "mission_append", 14) == 0;
+            const char *steps = buf + (append ? 14 : 7);
+            if (mission_load(steps, append) == 0) {
+                printf("[mission] rejected: %s\n", buf);
+                diag_count(DIAG_CTRL_REJECTED);
+            }
+            else {
+                if (!append) g_desired_cmd = CMD_STOP;
+                stall_release();
+            }
+        }
+        telemetry_touch(addr, TELEMETRY_PORT);
+        pbuf_free(p);
+        return;
+    }
+
+    // Telemetry subscriptions: "sub <chan> <period_ms> [lease_ms] [port]", "unsub <chan> [port]"
+    if (telemetry_handle_cmd(buf, addr, TELEMETRY_PORT)) {
+        pbuf_free(p);
+        return;
+    }
+
+    // Stall recovery mode: "stall off|stop|avoid [backoff_ms]"
+    if (strncmp(buf, "stall", 5) == 0) {
+        if (!parse_stall(buf + 5)) diag_count(DIAG_CTRL_REJECTED);
+        pbuf_free(p);
+        return;
+    }
+
+    // Calibration: "calibrate" runs it, "calib_defaults" restores the built-in values
+    if (strncmp(buf, "calib", 5) == 0) {
+        if (strncmp(buf, "calib_defaults", 14) == 0) calib_reset_defaults();
+        else {
+            calib_start();
+            stall_release();
+        }
+        g_desired_cmd = CMD_STOP;
+        mission_abort();
+        telemetry_touch(addr, TELEMETRY_PORT);
+        pbuf_free(p);
+        return;
+    }
+
+    // Teleop: analog "vel l r", or the original text commands
+    const bool was_vel = g_vel_mode;
+    const DriveCmd was_cmd = g_desired_cmd;
+    const int16_t was_l = g_vel_left, was_r = g_vel_right;
+    if (strncmp(buf, "vel", 3) == 0) {
+        int16_t l, r;
+        if (parse_vel(buf + 3, &l, &r)) {
+            g_vel_left = l;
+            g_vel_right = r;
+            g_vel_mode = true;
+        } else {
+            g_vel_mode = false;
+            g_desired_cmd = CMD_STOP;
+            diag_count(DIAG_CTRL_REJECTED);
+        }
+    } else {
+        g_vel_mode = false;
+        g_desired_cmd = text_to_cmd(buf);
+    }
+    g_last_teleop_ms = to_ms_since_boot(get_absolute_time());
 
-    // Keep your telemetry pairing (remote IP, fixed TELEMETRY_PORT)
-    encoder_set_remote_udp_target(pcb, addr, TELEMETRY_PORT);
+    // A stop held after a stall lasts until the operator asks for something
+    // else; keepalives repeating the command that stalled leave it held.
+    if (g_vel_mode != was_vel ||
+        (g_vel_mode ? (g_vel_left != was_l || g_vel_right != was_r) : g_desired_cmd != was_cmd))
+        stall_release();
+
+    // Any teleop packet means the operator has taken over.
+    mission_abort();
+    calib_abort();
+
+    // Controllers get odom + fsm telemetry without subscribing (see telemetry.h)
+    telemetry_touch(addr, TELEMETRY_PORT);
 
     pbuf_free(p);
 }
@@ -78,9 +238,11 @@ static void udp_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
 
 int main(void) {
     // --- 1. System Init ---
+    diag_init();         // paint stacks before they are used much
     stdio_init_all();
     sleep_ms(2000); // Wait for USB serial
     printf("Recon Rover Systems Initializing...\n");
+    params_load();
 
     // --- 2. Wi-Fi Init ---
     if (cyw43_arch_init()) {
@@ -103,10 +265,12 @@ int main(void) {
 
     // --- 3. DRIVER Init ---
     motor_init_pins();
+    profile_init();
     motor_stop();
     printf("Motor controller initialized.\n");
 
     encoder_init();
+    stall_init();
     ultra_init();        
 
     // --- 4. UDP Server Init ---
@@ -120,17 +284,38 @@ int main(void) {
         printf("UDP bind failed: %d\n", err);
         return -1;
     }
+    telemetry_init(udp_server);
     udp_recv(udp_server, udp_recv_cb, NULL);
     printf("UDP server listening for commands on port %d\n", CTRL_PORT);
-    printf("UDP server will send telemetry to port %d\n", TELEMETRY_PORT);
+    printf("UDP server will send telemetry to port %d (or as subscribed)\n", TELEMETRY_PORT);
 
     // --- 5. Main Loop ---
     printf("Initialization complete. Entering main loop.\n\n");
     while (true) {
         // Decide what actually goes to the motors:
-        // - If path is clear: pass-through g_desired_cmd
+        // - A running mission replaces teleop as the desired command
+        // - If path is clear: pass-through the desired command
         // - If obstacle ahead (forward-ish intent): auto avoid, then hand back
-        ultra_obstacle_aware_apply(g_desired_cmd);
+        // - Teleop (text or analog) times out to STOP without keepalives
+        // (Calibration, while running, drives the motors itself.)
+        // - A wheel stall has already cut the motors; recovery starts here.
+        //   Nothing else drives in that pass, nor while a stop is held.
+        diag_pass_begin();
+        bool held = stall_service();
+        bool calibrating = calib_tick();
+        if (!calibrating && !held) {
+            uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+            bool stale = (now_ms - g_last_teleop_ms) > TELEOP_TIMEOUT_MS;
+            DriveCmd desired = stale ? CMD_STOP : g_desired_cmd;
+
+            if (mission_tick(&desired) || stale || !g_vel_mode)
+                ultra_obstacle_aware_apply(desired);
+            else
+                ultra_obstacle_aware_velocity(g_vel_left, g_vel_right);
+        }
+        // A held stop or a calibration phase timing out leaves the loop
+        // spinning: that is waiting, not load (see diag.h)
+        if (held || calib_waiting()) diag_pass_idle();
 
         tight_loop_contents();
     }
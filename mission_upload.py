@@ -0,0 +1,49 @@
+import socket
+import sys
+
+ROVER_IP = "172.20.10.2"  # Replace with your rover's IP
+ROVER_PORT = 5000
+
+# Each step is either:
+#   w <x_mm> <y_mm>   drive to a point (x = straight ahead at start, y = left)
+#   t <cmd> <ms>      hold a command (forward, left, backward_right, stop...)
+# The whole list goes up in ONE datagram; the rover follows it on its own
+# using encoder odometry, with obstacle avoidance still active.
+DEFAULT_MISSION = [
+    "w 500 0",
+    "w 500 500",
+    "w 0 500",
+    "w 0 0",
+    "t stop 100",
+]
+
+USAGE = """Usage:
+  python mission_upload.py                 upload DEFAULT_MISSION
+  python mission_upload.py "w 300 0; t left 250"
+  python mission_upload.py --append "w 600 0"
+  python mission_upload.py --abort"""
+
+sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+args = sys.argv[1:]
+if args and args[0] in ("-h", "--help"):
+    print(USAGE)
+    sys.exit(0)
+
+if args and args[0] == "--abort":
+    packet = "mission_abort"
+elif args and args[0] == "--append":
+    packet = "mission_append " + " ".join(args[1:])
+elif args:
+    packet = "mission " + " ".join(args)
+else:
+    packet = "mission " + "; ".join(DEFAULT_MISSION)
+
+if len(packet) > 511:
+    print(f"Mission too long ({len(packet)} bytes, rover accepts 511)")
+    sys.exit(1)
+
+sock.sendto(packet.encode(), (ROVER_IP, ROVER_PORT))
+print(f"Sent to {ROVER_IP}:{ROVER_PORT}: {packet}")
+print("Watch progress (M: lines) with telemetry_listener.py")
+sock.close()
@@ -1,31 +1,166 @@
+import argparse
 import socket
+import statistics
+import time
 
 # --- SETTINGS ---
+ROVER_IP = "172.20.10.2"  # Replace with your rover's IP
+ROVER_PORT = 5000
 LISTEN_IP = "0.0.0.0"  # Listen on all available network interfaces
 LISTEN_PORT = 5001     # MUST match TELEMETRY_PORT in main.c
+LEASE_MS = 10000       # rover drops the subscription if not renewed in time
 # ---
 
-# Create a UDP socket
-sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-
-# Bind the socket to the port
-try:
-    sock.bind((LISTEN_IP, LISTEN_PORT))
-    print(f"--- Listening for telemetry on port {LISTEN_PORT} ---")
-except OSError as e:
-    print(f"Error: Could not bind to port {LISTEN_PORT}. Is another program using it?")
-    print(e)
-    exit()
-
-# Loop forever, printing any data we receive
-try:
-    while True:
-        data, addr = sock.recvfrom(1024)  # 1024 bytes buffer
-        message = data.decode('utf-8')
-        
-        # We print an extra newline to separate the packets
-        print(f"From {addr[0]}:\n{message}") 
-
-except KeyboardInterrupt:
-    print("\n--- Stopping listener ---")
-    sock.close()
\ No newline at end of file
+# The rover only streams to subscribers, so this asks for the channels it
+# wants ("sub <chan> <period_ms> <lease_ms> <port>") and renews the lease
+# at half its length. Several copies can run at once on different ports.
+#
+#   python telemetry_listener.py                     odom + fsm every 500 ms
+#   python telemetry_listener.py -c range -p 50      range at 20 Hz
+#   python telemetry_listener.py --load 12 -p 50     many-subscriber load test
+#
+# rover_teleop.py binds port 5001 for its pongs and status stream; next to
+# it, run this on another port (--port 5002).
+
+
+def subscribe(sock, rover, channels, period, lease, port):
+    for chan in channels:
+        sock.sendto(f"sub {chan} {period} {lease} {port}".encode(), rover)
+
+
+def listen(args):
+    rover = (args.rover, ROVER_PORT)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        sock.bind((LISTEN_IP, args.port))
+        print(f"--- Listening for telemetry on port {args.port} ---")
+    except OSError as e:
+        print(f"Error: Could not bind to port {args.port}. Is another program using it?")
+        print(e)
+        return
+
+    sock.settimeout(0.5)
+    renew = 0.0
+    try:
+        while True:
+            if time.monotonic() >= renew:
+                subscribe(sock, rover, args.channels, args.period, LEASE_MS, args.port)
+                renew = time.monotonic() + LEASE_MS / 2000.0
+            try:
+                data, addr = sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            message = data.decode('utf-8', 'replace')
+
+            # We print an extra newline to separate the packets
+            print(f"From {addr[0]}:\n{message}")
+
+    except KeyboardInterrupt:
+        print("\n--- Stopping listener ---")
+    finally:
+        for chan in args.channels:
+            sock.sendto(f"unsub {chan} {args.port}".encode(), rover)
+        sock.close()
+
+
+def load_test(args):
+    """N subscribers, each on its own socket, at the same period. Reports how
+    many samples each one got against the expected count, and the gaps. One
+    extra socket takes the diag channel so the rover's CPU load and pbuf
+    failures can be compared with and without the load. Subscribers the
+    rover turned away ("sub full") are counted on their own and left out of
+    the delivery figures."""
+    rover = (args.rover, ROVER_PORT)
+    socks = []
+    for _ in range(args.load):
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.bind((LISTEN_IP, 0))
+        s.setblocking(False)
+        socks.append(s)
+    diag = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    diag.bind((LISTEN_IP, 0))
+    diag.setblocking(False)
+
+    arrivals = [[] for _ in socks]
+    refused = [0] * len(socks)
+    diag_refused = 0
+    last_diag = ""
+    t_end = time.monotonic() + args.seconds
+    renew = 0.0
+    print(f"{args.load} subscribers x {args.channels} every {args.period} ms for {args.seconds} s")
+
+    while time.monotonic() < t_end:
+        now = time.monotonic()
+        if now >= renew:
+            for s in socks:
+                subscribe(s, rover, args.channels, args.period, LEASE_MS, s.getsockname()[1])
+            subscribe(diag, rover, ["diag"], 1000, LEASE_MS, diag.getsockname()[1])
+            renew = now + LEASE_MS / 2000.0
+        for i, s in enumerate(socks):
+            while True:
+                try:
+                    data = s.recv(2048)
+                except BlockingIOError:
+                    break
+                if data.startswith(b"sub full") or data.startswith(b"sub rejected"):
+                    refused[i] += 1
+                elif not data.startswith(b"sub "):
+                    arrivals[i].append(time.monotonic())
+        try:
+            while True:
+                text = diag.recv(2048).decode('utf-8', 'replace')
+                if text.startswith("sub full") or text.startswith("sub rejected"):
+                    diag_refused += 1
+                elif not text.startswith("sub "):
+                    last_diag = text
+        except BlockingIOError:
+            pass
+        time.sleep(0.002)
+
+    for s in socks:
+        s.sendto(b"unsub all " + str(s.getsockname()[1]).encode(), rover)
+        s.close()
+    diag.sendto(b"unsub all " + str(diag.getsockname()[1]).encode(), rover)
+    diag.close()
+
+    n_chan = 4 if "all" in args.channels else len(args.channels)
+    expected = args.seconds * 1000.0 / args.period * n_chan
+    accepted = [a for a, r in zip(arrivals, refused) if not r]
+    n_refused = sum(1 for r in refused if r)
+    print(f"subscribers: {len(accepted)} accepted | {n_refused} refused by the rover (sub full)"
+          + (" | diag socket refused too" if diag_refused else ""))
+    if not accepted:
+        return
+    ratios = [len(a) / expected for a in accepted]
+    gaps = [(b - a) * 1000.0 for a_list in accepted for a, b in zip(a_list, a_list[1:])]
+    print(f"delivered/expected: min {min(ratios):.2f} | median {statistics.median(ratios):.2f} | "
+          f"max {max(ratios):.2f}  ({expected:.0f} expected each, accepted subscribers only)")
+    if gaps:
+        gaps.sort()
+        print(f"inter-arrival ms: median {statistics.median(gaps):.1f} | "
+              f"p95 {gaps[int(0.95 * (len(gaps) - 1))]:.1f} | max {gaps[-1]:.1f}")
+    if last_diag:
+        print("--- last rover diag report ---")
+        print(last_diag)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Rover telemetry subscriber")
+    ap.add_argument("--rover", default=ROVER_IP)
+    ap.add_argument("--port", type=int, default=LISTEN_PORT, help="local port to receive on (use another one while rover_teleop.py holds 5001)")
+    ap.add_argument("-c", "--channels", nargs="+", default=["odom", "fsm"],
+                    help="odom, range, fsm, diag or all")
+    ap.add_argument("-p", "--period", type=int, default=500, help="ms between samples (>= 20)")
+    ap.add_argument("--load", type=int, metavar="N", help="run the load test with N subscribers; the rover holds 16 (address, port) "
+                         "subscribers, and the diag socket and any controller take one each")
+    ap.add_argument("--seconds", type=float, default=10.0, help="load test duration")
+    args = ap.parse_args()
+
+    if args.load:
+        load_test(args)
+    else:
+        listen(args)
+
+
+if __name__ == "__main__":
+    main()